@@ -0,0 +1,55 @@
+#!/bin/bash
+# Compares the run time of two FpDebug builds on the example programs.
+#
+# usage: ./benchmark.sh <valgrind binary A> <valgrind binary B> [fpdebug options]
+#
+# fbench is not part of the repository, download fbench.c to this folder first
+# (see README). Each program is run once with --tool=none as a reference. For
+# dispatch, the difference of A and B per floating-point operation is printed.
+set -e
+
+if [ $# -lt 2 ]; then
+	echo "usage: $0 <valgrind binary A> <valgrind binary B> [fpdebug options]"
+	exit 1
+fi
+
+VG_A=$1
+VG_B=$2
+shift 2
+FD_OPTS="$@"
+
+DIR=$(cd "$(dirname "$0")" && pwd)
+OUT=$(mktemp -d)
+PENDULUM_STEPS=${PENDULUM_STEPS:-100000}
+FBENCH_ITERATIONS=${FBENCH_ITERATIONS:-1000}
+DISPATCH_ITERATIONS=${DISPATCH_ITERATIONS:-1000000}
+# DISPATCH_OPS of dispatch.c
+DISPATCH_OPS=8
+
+g++ -O0 -g "${DIR}"/pendulum.cpp -o "${OUT}"/pendulum
+gcc -O1 -g "${DIR}"/dispatch.c -o "${OUT}"/dispatch
+PROGRAMS=("${OUT}/pendulum ${PENDULUM_STEPS}" "${OUT}/dispatch ${DISPATCH_ITERATIONS}")
+if [ -f "${DIR}"/fbench.c ]; then
+	gcc -O0 -g "${DIR}"/fbench.c -lm -o "${OUT}"/fbench
+	PROGRAMS+=("${OUT}/fbench ${FBENCH_ITERATIONS}")
+fi
+
+TIMEFORMAT=%R
+run() {
+	# run in the output folder, FpDebug writes its reports next to the client
+	( cd "${OUT}" && time "$@" >/dev/null 2>&1 ) 2>&1
+}
+
+printf "%-30s %10s %10s %10s\n" "program" "none" "A" "B"
+for p in "${PROGRAMS[@]}"; do
+	t_none=$(run "${VG_A}" --tool=none ${p})
+	t_a=$(run "${VG_A}" --tool=fpdebug ${FD_OPTS} ${p})
+	t_b=$(run "${VG_B}" --tool=fpdebug ${FD_OPTS} ${p})
+	printf "%-30s %10s %10s %10s\n" "$(basename ${p})" "${t_none}" "${t_a}" "${t_b}"
+	if [ "$(basename ${p%% *})" = "dispatch" ]; then
+		t_diff=$(awk "BEGIN { printf \"%.1f\", (${t_a} - ${t_b}) * 1e9 / (${DISPATCH_ITERATIONS} * ${DISPATCH_OPS}) }")
+		echo "saved by B per operation: ${t_diff} ns"
+	fi
+done
+
+rm -rf "${OUT}"
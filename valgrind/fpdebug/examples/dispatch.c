@@ -0,0 +1,31 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+/* Tight loop of scalar SSE operations, float and double, for measuring
+   the cost of the analysis per operation (see benchmark.sh). Each
+   iteration executes DISPATCH_OPS floating-point operations, compile
+   with -O1 so that the values stay in registers. */
+#define DISPATCH_OPS	8
+
+int main(int argc, char** argv) {
+	long n = argc > 1 ? atol(argv[1]) : 1000000;
+	/* volatile, so that the compiler cannot fold the loop */
+	volatile double dSeed = 1.0000001;
+	volatile float fSeed = 1.0001f;
+	double d = dSeed, e = 0.5;
+	float f = fSeed, g = 0.5f;
+	long i;
+
+	for (i = 0; i < n; i++) {
+		d = d * dSeed;
+		e = e + d;
+		d = d / e;
+		e = e - d;
+		f = f * fSeed;
+		g = g + f;
+		f = f / g;
+		g = g - f;
+	}
+	printf("%d operations per iteration: %.17g %.9g\n", DISPATCH_OPS, d + e, f + g);
+	return 0;
+}
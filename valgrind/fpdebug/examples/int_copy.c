@@ -0,0 +1,32 @@
+#include <stdio.h>
+#include "../fpdebug.h"
+
+/* copies the bits of a double with an integer load and store, like a
+   memcpy or a union of a double and a long */
+static void copyBits(double* dst, const double* src) {
+	*(long*)dst = *(const long*)src;
+}
+
+/* called through a pointer, so that VEX does not chase the call into the
+   superblock of the caller, which has floating-point work */
+static void (*volatile copyFn)(double*, const double*) = copyBits;
+
+int main( int argc, const char* argv[] )
+{
+	printf("Test program: double copied with integer registers\n");
+
+	double sum = 0.0;
+	int i;
+	for (i = 0; i < 10; i++) {
+		sum += 0.1;
+	}
+
+	double copy;
+	copyFn(&copy, &sum);
+
+	printf("Sum: %.17e\n", sum);
+	printf("Copy: %.17e\n", copy);
+
+	VALGRIND_PRINT_ERROR(&"sum", &sum);
+	VALGRIND_PRINT_ERROR(&"copy", &copy);
+}
@@ -0,0 +1,39 @@
+#include <stdio.h>
+#include "../fpdebug.h"
+
+/* Adds 0.1 a million times in float and in double. The exact sums need
+   at most 73 bits, so every shadow backend except the stochastic one can
+   hold them exactly (see README for the expected reports). */
+#define SUMMANDS	1000000
+
+float sumFloat(void) {
+	float sum = 0.0f;
+	int i;
+	for (i = 0; i < SUMMANDS; i++) {
+		sum += 0.1f;
+	}
+	return sum;
+}
+
+double sumDouble(void) {
+	double sum = 0.0;
+	int i;
+	for (i = 0; i < SUMMANDS; i++) {
+		sum += 0.1;
+	}
+	return sum;
+}
+
+int main( int argc, const char* argv[] )
+{
+	printf("Test program: Summation\n");
+
+	float f = sumFloat();
+	double d = sumDouble();
+
+	printf("Float: %.9e\n", f);
+	printf("Double: %.17e\n", d);
+
+	VALGRIND_PRINT_ERROR(&"f", &f);
+	VALGRIND_PRINT_ERROR(&"d", &d);
+}
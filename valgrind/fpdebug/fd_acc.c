@@ -0,0 +1,177 @@
+
+/*--------------------------------------------------------------------*/
+/*--- Exact accumulators for sums in FpDebug.            fd_acc.c ---*/
+/*--------------------------------------------------------------------*/
+
+/*
+   This file is part of FpDebug, a heavyweight Valgrind tool for
+   detecting floating-point accuracy problems.
+
+   Copyright (C) 2010-2011 Florian Benz
+      florianbenz1@gmail.com
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2 of the
+   License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+   02111-1307, USA.
+
+   The GNU General Public License is contained in the file COPYING.
+*/
+
+
+/*
+   A long accumulator after Kulisch keeps a sum of doubles exactly, as a
+   fixed-point number in two's complement with ACC_WORDS words. Bit 0 of
+   the lowest word is 2^-1074, the smallest subnormal, the largest double
+   ends in word ACC_WORDS - 2 and the top word takes the carries and the
+   sign. Adding a double only shifts its mantissa to the position given by
+   its exponent and adds it with integer carries, nothing is rounded.
+   Only finite doubles can be added.
+*/
+
+#define ACC_LSB_EXP			1074
+
+static __inline__
+void accClear(Accumulator* acc) {
+	Int i;
+	for (i = 0; i < ACC_WORDS; i++) {
+		acc->w[i] = 0;
+	}
+}
+
+static __inline__
+void accCopy(Accumulator* dst, const Accumulator* src) {
+	Int i;
+	for (i = 0; i < ACC_WORDS; i++) {
+		dst->w[i] = src->w[i];
+	}
+}
+
+static __inline__
+Bool accIsNegative(const Accumulator* acc) {
+	return (Bool)(acc->w[ACC_WORDS - 1] >> 63);
+}
+
+/* adds x to the words from i on, the carry runs up as far as needed */
+static __inline__
+void accAddWord(Accumulator* acc, Int i, ULong x) {
+	for (; x != 0 && i < ACC_WORDS; i++) {
+		ULong old = acc->w[i];
+		acc->w[i] += x;
+		x = acc->w[i] < old;
+	}
+}
+
+static __inline__
+void accSubWord(Accumulator* acc, Int i, ULong x) {
+	for (; x != 0 && i < ACC_WORDS; i++) {
+		ULong old = acc->w[i];
+		acc->w[i] -= x;
+		x = acc->w[i] > old;
+	}
+}
+
+/* adds x, or subtracts it if negate is set */
+static void accAddDouble(Accumulator* acc, Double x, Bool negate) {
+	ULong bits = *(ULong*)&x;
+	ULong m = bits & 0xFFFFFFFFFFFFFULL;
+	Int e = (Int)((bits >> 52) & 0x7FF);
+	Int pos, shift;
+	ULong lo, hi;
+
+	tl_assert(e != 0x7FF);
+	if (e == 0) {
+		/* subnormals have the exponent of the smallest normal number */
+		if (m == 0) {
+			return;
+		}
+		e = 1;
+	} else {
+		m |= 1ULL << 52;
+	}
+	/* x = m * 2^(e - 1075), so bit 0 of m is at bit e - 1 */
+	pos = e - 1;
+	shift = pos & 63;
+	lo = m << shift;
+	hi = shift == 0 ? 0 : m >> (64 - shift);
+
+	if ((Bool)(bits >> 63) != negate) {
+		accSubWord(acc, pos >> 6, lo);
+		accSubWord(acc, (pos >> 6) + 1, hi);
+	} else {
+		accAddWord(acc, pos >> 6, lo);
+		accAddWord(acc, (pos >> 6) + 1, hi);
+	}
+}
+
+/* adds b, or subtracts it if negate is set */
+static void accAdd(Accumulator* acc, const Accumulator* b, Bool negate) {
+	ULong carry = 0;
+	Int i;
+
+	for (i = 0; i < ACC_WORDS; i++) {
+		ULong x = negate ? ~b->w[i] : b->w[i];
+		ULong old = acc->w[i];
+		acc->w[i] += x;
+		ULong c = acc->w[i] < old;
+		acc->w[i] += carry;
+		c |= acc->w[i] < carry;
+		carry = c;
+	}
+	/* -b is ~b + 1 */
+	if (negate) {
+		accAddWord(acc, 0, 1);
+	}
+}
+
+/* Writes the absolute value to mag and returns the sign. The nonzero words
+   of mag are lo to hi, hi is -1 if the sum is zero. */
+static Bool accMagnitude(const Accumulator* acc, ULong* mag, Int* lo, Int* hi) {
+	Bool neg = accIsNegative(acc);
+	ULong carry = 1;
+	Int i;
+
+	*lo = -1;
+	*hi = -1;
+	for (i = 0; i < ACC_WORDS; i++) {
+		mag[i] = acc->w[i];
+		if (neg) {
+			mag[i] = ~mag[i] + carry;
+			carry = carry && mag[i] == 0;
+		}
+		if (mag[i] != 0) {
+			if (*lo < 0) {
+				*lo = i;
+			}
+			*hi = i;
+		}
+	}
+	return neg;
+}
+
+/* exponent as returned by mpfr_get_exp, False if the sum is zero */
+static Bool accExp(const Accumulator* acc, Long* e) {
+	ULong mag[ACC_WORDS];
+	Int lo, hi;
+
+	accMagnitude(acc, mag, &lo, &hi);
+	if (hi < 0) {
+		return False;
+	}
+	*e = (Long)hi * 64 + 63 - leadingZeros(mag[hi]) + 1 - ACC_LSB_EXP;
+	return True;
+}
+
+/*--------------------------------------------------------------------*/
+/*--- end                                                          ---*/
+/*--------------------------------------------------------------------*/
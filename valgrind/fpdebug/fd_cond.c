@@ -0,0 +1,144 @@
+
+/*--------------------------------------------------------------------*/
+/*--- First-order error propagation for FpDebug.        fd_cond.c ---*/
+/*--------------------------------------------------------------------*/
+
+/*
+   This file is part of FpDebug, a heavyweight Valgrind tool for
+   detecting floating-point accuracy problems.
+
+   Copyright (C) 2010-2011 Florian Benz
+      florianbenz1@gmail.com
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2 of the
+   License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+   02111-1307, USA.
+
+   The GNU General Public License is contained in the file COPYING.
+*/
+
+/*
+   Instead of a more precise value, a shadow value is kept as two doubles:
+   the value in the precision of the original operation and a bound of
+   its relative error. The bound is propagated with the condition number
+   of each operation, to first order. For an addition a + b this is
+   |a| / |a + b| * ea + |b| / |a + b| * eb, for a multiplication or a
+   division ea + eb and for a square root ea / 2. The unit roundoff of
+   float or double is added if the operation itself rounds, which the
+   error-free transformations of fd_qd.c tell.
+   Values without a shadow value have no error.
+   The operations take the number of parts n of PartsOps, which is always 2.
+*/
+
+#define COND_VALUE			0
+#define COND_ERROR			1
+
+static __inline__
+Double condUnitRoundoff(Bool isFloat) {
+	/* 2^-24 and 2^-53 */
+	return isFloat ? 5.9604644775390625e-08 : 1.1102230246251565e-16;
+}
+
+/* the local rounding error of r, err is the error of the double result */
+static __inline__
+Double condRounding(Double r, Double err, Bool isFloat) {
+	if (err != 0 || (isFloat && (Double)(Float)r != r)) {
+		return condUnitRoundoff(isFloat);
+	}
+	return 0;
+}
+
+/* the propagated error of an infinite or NaN result is meaningless */
+static __inline__
+void condSet(Double value, Double error, Bool isFloat, Double* r) {
+	if (isFloat) {
+		value = (Float)value;
+	}
+	r[COND_VALUE] = value;
+	r[COND_ERROR] = isFiniteDouble(value) ? error : 0;
+}
+
+static __inline__
+void condSetDouble(Int n, Double x, Double* r) {
+	r[COND_VALUE] = x;
+	r[COND_ERROR] = 0;
+}
+
+static void condAddValues(Bool isFloat, Double a, Double ea, Double b, Double eb, Double* r) {
+	Double s = a + b;
+	Double absError = absDouble(a) * ea + absDouble(b) * eb;
+	Double error = 0;
+
+	if (absError != 0) {
+		/* a total cancellation of inexact values leaves no correct digit,
+		   the relative error is 1 then */
+		error = s != 0 ? absError / absDouble(s) : 1;
+	}
+	condSet(s, error + condRounding(s, twoSumErr(a, b, s), isFloat), isFloat, r);
+}
+
+static __inline__
+void condAdd(Int n, Bool isFloat, const Double* a, const Double* b, Double* r) {
+	condAddValues(isFloat, a[COND_VALUE], a[COND_ERROR], b[COND_VALUE], b[COND_ERROR], r);
+}
+
+static __inline__
+void condSub(Int n, Bool isFloat, const Double* a, const Double* b, Double* r) {
+	condAddValues(isFloat, a[COND_VALUE], a[COND_ERROR], -b[COND_VALUE], b[COND_ERROR], r);
+}
+
+static void condMul(Int n, Bool isFloat, const Double* a, const Double* b, Double* r) {
+	Double p = a[COND_VALUE] * b[COND_VALUE];
+	Double err = isFiniteDouble(p) ? twoProdErr(a[COND_VALUE], b[COND_VALUE], p) : 0;
+	condSet(p, a[COND_ERROR] + b[COND_ERROR] + condRounding(p, err, isFloat), isFloat, r);
+}
+
+/* the division and the square root are exact if the remainder is zero */
+static void condDiv(Int n, Bool isFloat, const Double* a, const Double* b, Double* r) {
+	Double q = a[COND_VALUE] / b[COND_VALUE];
+	Double rem = divRemainder(a[COND_VALUE], b[COND_VALUE], q);
+	condSet(q, a[COND_ERROR] + b[COND_ERROR] + condRounding(q, rem, isFloat), isFloat, r);
+}
+
+static void condSqrt(Int n, Bool isFloat, const Double* a, Double* r) {
+	Double s = sqrtDouble(a[COND_VALUE]);
+	Double rem = sqrtRemainder(a[COND_VALUE], s);
+	condSet(s, a[COND_ERROR] / 2 + condRounding(s, rem, isFloat), isFloat, r);
+}
+
+static __inline__
+void condNeg(Int n, const Double* a, Double* r) {
+	r[COND_VALUE] = -a[COND_VALUE];
+	r[COND_ERROR] = a[COND_ERROR];
+}
+
+static __inline__
+void condAbs(Int n, const Double* a, Double* r) {
+	r[COND_VALUE] = absDouble(a[COND_VALUE]);
+	r[COND_ERROR] = a[COND_ERROR];
+}
+
+static void condMinMax(Int n, const Double* a, const Double* b, Bool max, Double* r) {
+	const Double* res = minMaxIsFirstDouble(a[COND_VALUE], b[COND_VALUE], max) ? a : b;
+	r[COND_VALUE] = res[COND_VALUE];
+	r[COND_ERROR] = res[COND_ERROR];
+}
+
+static const PartsOps condOps = {
+	condSetDouble, condAdd, condSub, condMul, condDiv, condSqrt, condNeg, condAbs, condMinMax
+};
+
+/*--------------------------------------------------------------------*/
+/*--- end                                                          ---*/
+/*--------------------------------------------------------------------*/
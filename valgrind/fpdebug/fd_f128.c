@@ -0,0 +1,229 @@
+
+/*--------------------------------------------------------------------*/
+/*--- Binary128 arithmetic for FpDebug.                 fd_f128.c ---*/
+/*--------------------------------------------------------------------*/
+
+/*
+   This file is part of FpDebug, a heavyweight Valgrind tool for
+   detecting floating-point accuracy problems.
+
+   Copyright (C) 2010-2011 Florian Benz
+      florianbenz1@gmail.com
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2 of the
+   License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+   02111-1307, USA.
+
+   The GNU General Public License is contained in the file COPYING.
+*/
+
+/*
+   IEEE binary128 values (113 bits) with the __float128 type of GCC. The
+   arithmetic is done by the soft-float routines of libgcc, which the tool
+   is linked against anyway, and not by libquadmath. Only the square root
+   is missing there, it is computed by Newton iteration.
+   The values are stored in the parts of shadow data (see fd_qd.c), which
+   are only 8-byte aligned, so they are loaded and stored with loadF128
+   and storeF128.
+*/
+
+#if defined(VGA_amd64) || defined(VGA_x86)
+#define FD_HAVE_F128
+
+typedef __float128 Float128;
+typedef __float128 Float128Store __attribute__((aligned(8)));
+
+/* little endian, the sign, the exponent and the upper 48 bits of the
+   fraction are in w[1] */
+typedef
+	union {
+		Float128	f;
+		ULong		w[2];
+	} Float128Bits;
+
+#define F128_BIAS			16383
+#define F128_MAX_EXP		0x7FFF
+
+static __inline__
+Float128 loadF128(const Double* p) {
+	return *(const Float128Store*)p;
+}
+
+static __inline__
+void storeF128(Double* p, Float128 x) {
+	*(Float128Store*)p = x;
+}
+
+static __inline__
+UInt f128ExpBits(Float128 x) {
+	Float128Bits b;
+	b.f = x;
+	return (UInt)((b.w[1] >> 48) & F128_MAX_EXP);
+}
+
+/* 2^e for -16382 <= e <= 16383 */
+static __inline__
+Float128 f128Pow2(Int e) {
+	Float128Bits b;
+	b.w[0] = 0;
+	b.w[1] = (ULong)(e + F128_BIAS) << 48;
+	return b.f;
+}
+
+/* x = m * 2^e with 0.5 <= |m| < 1, only for finite values except zero */
+static Float128 f128Frexp(Float128 x, Int* e) {
+	Float128Bits b;
+	Int shift = 0;
+
+	if (f128ExpBits(x) == 0) {
+		/* subnormal */
+		x *= f128Pow2(113);
+		shift = 113;
+	}
+	b.f = x;
+	*e = (Int)((b.w[1] >> 48) & F128_MAX_EXP) - (F128_BIAS - 1) - shift;
+	b.w[1] = (b.w[1] & ~((ULong)F128_MAX_EXP << 48)) | ((ULong)(F128_BIAS - 1) << 48);
+	return b.f;
+}
+
+static Float128 f128Ldexp(Float128 x, Long e) {
+	/* beyond this the result is zero or infinity anyway */
+	if (e > 40000) {
+		e = 40000;
+	} else if (e < -40000) {
+		e = -40000;
+	}
+	while (e > 16000) {
+		x *= f128Pow2(16000);
+		e -= 16000;
+	}
+	while (e < -16000) {
+		x *= f128Pow2(-16000);
+		e += 16000;
+	}
+	return x * f128Pow2((Int)e);
+}
+
+/* Newton iteration s = s + (m - s^2) / 2s on the mantissa */
+static Float128 f128SqrtValue(Float128 x) {
+	Int e, i;
+
+	if (!(x > 0) || f128ExpBits(x) == F128_MAX_EXP) {
+		/* zero, negative, infinity and NaN */
+		return (Float128)sqrtDouble((Double)x);
+	}
+
+	Float128 m = f128Frexp(x, &e);
+	if (e & 1) {
+		m *= 2;
+		e--;
+	}
+	Float128 s = sqrtDouble((Double)m);
+	for (i = 0; i < 2; i++) {
+		s += (m - s * s) / (2 * s);
+	}
+	return f128Ldexp(s, e / 2);
+}
+
+static __inline__
+void f128SetDouble(Int n, Double x, Double* r) {
+	storeF128(r, (Float128)x);
+}
+
+static __inline__
+void f128Add(Int n, Bool isFloat, const Double* a, const Double* b, Double* r) {
+	storeF128(r, loadF128(a) + loadF128(b));
+}
+
+static __inline__
+void f128Sub(Int n, Bool isFloat, const Double* a, const Double* b, Double* r) {
+	storeF128(r, loadF128(a) - loadF128(b));
+}
+
+static __inline__
+void f128Mul(Int n, Bool isFloat, const Double* a, const Double* b, Double* r) {
+	storeF128(r, loadF128(a) * loadF128(b));
+}
+
+static __inline__
+void f128Div(Int n, Bool isFloat, const Double* a, const Double* b, Double* r) {
+	storeF128(r, loadF128(a) / loadF128(b));
+}
+
+static __inline__
+void f128Sqrt(Int n, Bool isFloat, const Double* a, Double* r) {
+	storeF128(r, f128SqrtValue(loadF128(a)));
+}
+
+static __inline__
+void f128Neg(Int n, const Double* a, Double* r) {
+	storeF128(r, -loadF128(a));
+}
+
+static __inline__
+void f128Abs(Int n, const Double* a, Double* r) {
+	Float128Bits b;
+	b.f = loadF128(a);
+	b.w[1] &= ~(1ULL << 63);
+	storeF128(r, b.f);
+}
+
+static void f128MinMax(Int n, const Double* a, const Double* b, Bool max, Double* r) {
+	Float128 x = loadF128(a);
+	Float128 y = loadF128(b);
+	storeF128(r, minMaxIsFirst(x != x, y != y, (x > y) - (x < y), max) ? x : y);
+}
+
+static const PartsOps f128Ops = {
+	f128SetDouble, f128Add, f128Sub, f128Mul, f128Div, f128Sqrt, f128Neg, f128Abs, f128MinMax
+};
+
+/* exponent as returned by mpfr_get_exp, only for normal numbers */
+static __inline__
+Bool f128Exp(const Double* a, Long* e) {
+	UInt bits = f128ExpBits(loadF128(a));
+	if (bits == 0 || bits == F128_MAX_EXP) {
+		return False;
+	}
+	*e = (Long)bits - (F128_BIAS - 1);
+	return True;
+}
+
+static Double f128RelError(const Double* a, Double org) {
+	Float128 x = loadF128(a);
+	Float128 rel;
+
+	if (x == 0 && org == 0) {
+		return 0;
+	}
+	rel = (x - org) / x;
+	return (Double)(rel < 0 ? -rel : rel);
+}
+
+/* Splits a mantissa into three doubles, the sum is exact because the
+   doubles have 159 bits together. */
+static __inline__
+void f128Split(Float128 m, Double* hi, Double* mid, Double* lo) {
+	*hi = (Double)m;
+	m -= *hi;
+	*mid = (Double)m;
+	m -= *mid;
+	*lo = (Double)m;
+}
+
+#endif /* defined(VGA_amd64) || defined(VGA_x86) */
+
+/*--------------------------------------------------------------------*/
+/*--- end                                                          ---*/
+/*--------------------------------------------------------------------*/
@@ -59,32 +59,260 @@ typedef
    }
    OrgType;
 
+/* Arithmetic of the shadow values, selected with --shadow-backend. */
+typedef
+   enum {
+      Sb_MPFR,
+      Sb_DD,
+      Sb_QD,
+      Sb_F128,
+      Sb_STOCH,
+      Sb_COND
+   }
+   ShadowBackend;
+
+/* Floating-point work of a superblock, see --skip-int-blocks. */
+typedef
+   enum {
+      /* neither floating-point operations nor data */
+      Bk_INT,
+      /* moves floating-point data, but no operations */
+      Bk_MOVE,
+      Bk_FP
+   }
+   BlockKind;
+
+/* Kind of a rule of --precision-file. */
+typedef
+   enum {
+      Pr_FUN,
+      Pr_FILE,
+      Pr_RANGE
+   }
+   PrecisionRuleKind;
+
+typedef
+	struct {
+		PrecisionRuleKind	kind;
+		/* function or file name, may contain '*' and '?' */
+		Char*				pattern;
+		Addr				start;
+		Addr				end;
+		mpfr_prec_t			prec;
+	} PrecisionRule;
+
+/* Representation of shadow data, see ShadowData. */
+typedef
+   enum {
+      Sr_MPFR,
+      Sr_EXACT,
+      Sr_PARTS,
+      Sr_ACC
+   }
+   ShadowRepr;
+
 /*
-	Node with per-allocation information that will be stored in a hash map.
-	As specified in <pub_tool_hashtable.h>, the first member must be a pointer
-	and the second member must be an UWord.
+	Value of a shadow value. Once computed it is never changed, so all
+	temporaries, registers and memory locations holding a copy of the value
+	share it and moving a value only copies a pointer and counts a
+	reference. Only an arithmetic operation creates a new one.
+	As long as the value is exactly equal to the original value, only the
+	native value is kept and value is computed when it is needed.
+	With the other backends than MPFR, the value is kept as double-double,
+	quad-double or binary128 parts instead. They directly follow the struct
+	and share the memory with the limbs, so value replaces them as soon as
+	it is computed.
+	Results of a summation site with --exact-sums keep a pointer to an
+	Accumulator there instead, until they are read by another operation.
+	The metadata is cold and kept in ShadowDataCold, at index cold of a
+	parallel array, so that the hot part and the limbs stay compact.
  */
-typedef struct _ShadowValue {
-	struct _ShadowValue* 	next;
-		UWord              	key;
-
-		Bool				active;
-		UInt				version;
+typedef struct _ShadowData {
+		/* links the free list of the slab allocator while the data is free */
+		Double				native;
+		UInt				refCount;
+		UInt				cold;
+		UChar				slabClass;
+		/* ShadowRepr */
+		UChar				repr;
+		Bool				hasValue;
+
+		/* the parts or the limbs of value follow directly after the struct */
+		mpfr_t				value;
+	} ShadowData;
 
+typedef
+	struct {
 		ULong				opCount;
 		Addr				origin;
 
 		mpfr_exp_t			canceled;
-		Addr				cancelOrigin;		
+		Addr				cancelOrigin;
 
+		/* to find the data by the handles in the guest state */
+		struct _ShadowData*	data;
+	} ShadowDataCold;
+
+/*
+	Node with per-allocation information. Shadow values of the memory are
+	stored in the two-level shadow map below, the key is the address of the
+	original value. The layout still follows <pub_tool_hashtable.h>, the
+	first member must be a pointer and the second member must be an UWord.
+	The original value is only needed for reports and is kept in
+	ShadowValueCold, at index cold of a parallel array.
+ */
+typedef struct _ShadowValue {
+	struct _ShadowValue* 	next;
+		UWord              	key;
+
+		ShadowData*			data;
+		UInt				version;
+		UInt				cold;
+		Bool				active;
+		/* set on access, cleared by the clock hand of the eviction */
+		Bool				referenced;
+	} ShadowValue;
+
+typedef
+	struct {
 		OrgType				orgType;
 		union {
 			Float			fl;
 			Double			db;
 		} Org;
+	} ShadowValueCold;
 
-		mpfr_t				value;
-	} ShadowValue;
+/*
+	Growable array for the cold parts. Objects of the slab allocator keep
+	their index when they are freed and reused, so it only grows as far as
+	the maximum number of objects in use.
+ */
+typedef
+	struct {
+		SizeT				elemSize;
+		Char*				elems;
+		UInt				used;
+		UInt				size;
+	} ColdArray;
+
+/*
+	Size class of the slab allocator. All objects of a class have the same
+	size, for shadow data this means the same precision. Freed objects are
+	kept in a free list that is linked through their first word.
+ */
+typedef
+	struct {
+		mpfr_prec_t			prec;
+		SizeT				objSize;
+
+		void*				freeList;
+		Char*				cur;
+		Char*				end;
+
+		ULong				slabs;
+		ULong				inUse;
+		ULong				maxInUse;
+	} SlabClass;
+
+/*
+	Shadow memory is a two-level map like in Memcheck. The primary map is
+	indexed by the upper address bits and points to secondary maps that
+	cover 64 KB of the address space each. A secondary map has one slot
+	per 4-byte word, so floats and doubles always get their own slot.
+	Secondary maps above the range of the primary map are kept in a hash
+	table, therefore the first two members are again next and key.
+	The shadow values are also counted per 4 KB page, so that ranges
+	without any, like most dead stack frames, are skipped fast.
+ */
+#define SM_BITS								16
+#define SM_SIZE								(1 << SM_BITS)
+#define SM_MASK								(SM_SIZE - 1)
+#define SM_SLOT_SHIFT						2
+#define SM_SLOTS							(SM_SIZE >> SM_SLOT_SHIFT)
+#define SM_PAGE_BITS						12
+#define SM_PAGES							(SM_SIZE >> SM_PAGE_BITS)
+#define SM_PAGE_SLOTS						(SM_SLOTS / SM_PAGES)
+
+typedef struct _ShadowSecMap {
+	struct _ShadowSecMap* 	next;
+		UWord				key;
+
+		struct _ShadowSecMap*	allNext;
+		UInt				used;
+		UShort				pageUsed[SM_PAGES];
+		ShadowValue*		slots[SM_SLOTS];
+	} ShadowSecMap;
+
+/* Heap block of the client, allocated by the malloc replacement. */
+typedef struct _HeapBlock {
+	struct _HeapBlock* 	next;
+		UWord				key;
+
+		SizeT				szB;
+	} HeapBlock;
+
+/* Number of memory shadow values evicted per origin because of --max-shadow-mb. */
+typedef struct _ShadowEviction {
+	struct _ShadowEviction* next;
+		UWord				key;
+
+		ULong				count;
+	} ShadowEviction;
+
+/* Exact sum of doubles, see fd_acc.c. */
+#define ACC_WORDS							34
+
+typedef
+	struct {
+		ULong				w[ACC_WORDS];
+	} Accumulator;
+
+/* Arithmetic of a backend other than MPFR on the parts of the shadow
+   values, see fd_qd.c, fd_f128.c, fd_stoch.c and fd_cond.c. n is the
+   number of parts, isFloat the precision of the original operation for
+   the backends that round to it. */
+typedef
+	struct {
+		void				(*setDouble)(Int n, Double x, Double* r);
+		void				(*add)(Int n, Bool isFloat, const Double* a, const Double* b, Double* r);
+		void				(*sub)(Int n, Bool isFloat, const Double* a, const Double* b, Double* r);
+		void				(*mul)(Int n, Bool isFloat, const Double* a, const Double* b, Double* r);
+		void				(*div)(Int n, Bool isFloat, const Double* a, const Double* b, Double* r);
+		void				(*sqrt)(Int n, Bool isFloat, const Double* a, Double* r);
+		void				(*neg)(Int n, const Double* a, Double* r);
+		void				(*abs)(Int n, const Double* a, Double* r);
+		void				(*minMax)(Int n, const Double* a, const Double* b, Bool max, Double* r);
+	} PartsOps;
+
+/* Number of executions of an addition or subtraction that added to its
+   own result, see --exact-sums. */
+typedef struct _AccSite {
+	struct _AccSite* 	next;
+		UWord				key;
+
+		ULong				count;
+	} AccSite;
+
+/* Number of promotions of an operation with --adaptive-precision. */
+typedef struct _PromotedSite {
+	struct _PromotedSite* next;
+		UWord				key;
+
+		ULong				count;
+	} PromotedSite;
+
+/* Operations whose error estimate with the precision of the check lane
+   differs from the one with the normal precision, see --precision. The
+   errors are the ones of the largest difference. */
+typedef struct _LaneSite {
+	struct _LaneSite* 	next;
+		UWord				key;
+
+		ULong				count;
+		Double				maxDiff;
+		mpfr_t				err;
+		mpfr_t				checkErr;
+	} LaneSite;
 
 typedef struct _MeanValue {
 	struct _MeanValue* 	next;
@@ -144,72 +372,12 @@ typedef struct _StageReport {
 		Addr				origin;
 	} StageReport;
 
-typedef
-	struct {
-		IROp	op;
-		IRTemp  wrTmp;
-		IRTemp	cond;
-		IRTemp	expr0;
-		IRTemp	exprX;
-
-		UChar	condVal;
-	} Mux0X;
-
-typedef
-	struct {
-		Float	orgFloat;
-		Double 	orgDouble;
-	} Store;
-
-typedef
-	struct {
-		UWord	bias;
-		Int		ix;
-	} CircularRegs;
-
-typedef
-	struct {
-		IROp	op;
-		IRTemp  wrTmp;
-		IRTemp	arg;
-
-		Float	orgFloat;
-		Double 	orgDouble;
-	} UnOp;
-
-typedef
-	struct {
-		IROp	op;
-		IRTemp  wrTmp;
-		IRTemp	arg1;
-		IRTemp	arg2;
-
-		Float	orgFloat;
-		Double 	orgDouble;
-	} BinOp;
-
-typedef
-	struct {
-		IROp	op;
-		IRTemp  wrTmp;
-		IRTemp	arg1;
-		IRTemp	arg2;
-		IRTemp	arg3;
-
-		Double 	orgDouble;
-	} TriOp;
-
+/* Native value of a temporary argument, passed to the helper as an
+   integer. Of vectors only the lowest 64 bits are kept. */
 typedef
 	struct {
 		IRType 	type;
-		UInt*	U128;
-
-		union {
-			Int		I32;
-			Long	I64;
-			Float	F32;
-			Double	F64;
-		} Val;
+		ULong	bits;
 	} ShadowTmp;
 
 typedef
@@ -228,5 +396,33 @@ typedef
 		} Val;
 	} ShadowConst;
 
+/*
+	Static arguments of an instrumented operation: the operation, the
+	temporaries and the constants. It is built when the operation is
+	instrumented and the dirty call only passes a pointer to it, together
+	with the native values of the arguments and of the result. The index
+	of an argument is the one of readSTemp, the bit 1 << index of
+	constArgs is set for constants. The descriptors of an address are
+	shared by all translations with the same arguments and never freed.
+ */
+typedef struct _OpDesc {
+	struct _OpDesc*		next;
+		UWord				key;
+
+		/* another descriptor of the same address */
+		struct _OpDesc*		alt;
+
+		IROp				op;
+		IRTemp				wrTmp;
+		IRTemp				arg[3];
+		IRType				argType[3];
+		UInt				constArgs;
+		ShadowConst			consts[3];
+		mpfr_prec_t			prec;
+		/* bit i is set if no later statement of the superblock reads the
+		   shadow value of argument i, only with --exact-sums */
+		UInt				lastUse;
+	} OpDesc;
+
 #endif /* ndef __FD_INCLUDE_H */
 
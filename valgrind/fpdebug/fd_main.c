@@ -40,15 +40,17 @@
    operation for which instructions should be added.
 
    For instance, the instructions for analysis a binary operation
-   are added in instrumentBinOp. Bascially a call to processBinOp
-   is added. So each time the client program performs a binary
-   floating-point operation, processBinOp is called.
+   are added in instrumentBinOp. Bascially a call to processBinOp,
+   or to its copy for the operation, is added. So each time the client
+   program performs a binary floating-point operation, processBinOp
+   is called.
 */ 
 
 #include "pub_tool_basics.h"
 #include "pub_tool_tooliface.h"
 #include "pub_tool_mallocfree.h"
 #include "pub_tool_machine.h"
+#include "pub_tool_guest.h"
 #include "pub_tool_libcprint.h"
 #include "pub_tool_libcassert.h"
 #include "pub_tool_threadstate.h"
@@ -62,22 +64,42 @@
 #include "pub_tool_xarray.h"
 #include "pub_tool_clientstate.h"
 #include "pub_tool_redir.h"
+#include "pub_tool_replacemalloc.h"
+#include "pub_tool_aspacemgr.h"
 
 #include "fd_include.h"
 /* for client requests */
 #include "fpdebug.h"
 
 #include "opToString.c"
+#include "fd_qd.c"
+#include "fd_f128.c"
+#include "fd_stoch.c"
+#include "fd_cond.c"
+#include "fd_acc.c"
 
 
+#define mkU8(_n)                			IRExpr_Const(IRConst_U8(_n))
 #define mkU32(_n)                			IRExpr_Const(IRConst_U32(_n))
 #define mkU64(_n)                			IRExpr_Const(IRConst_U64(_n))
+/* for the bodies of the helpers that are copied for each operation */
+#define FD_ALWAYS_INLINE					__inline__ __attribute__((always_inline))
 
 #define	MAX_STAGES							100
 #define	MAX_TEMPS							1000
-#define	MAX_REGISTERS						1000
 #define	CANCEL_LIMIT						10
+/* bits a double-double can lose by cancellation and still has 53 bits
+   with a margin */
+#define PROMOTE_CANCEL_LIMIT				40
+/* relative difference of the error estimates of the two lanes that is reported */
+#define LANE_DIFF_LIMIT						0.01
+/* additions to its own result after which a site is a summation site */
+#define ACC_DETECT_LIMIT					16
+/* steps of a summation site per computed relative error, see updateAccMeanValue */
+#define ACC_MEAN_INTERVAL					64
 #define TMP_COUNT							4
+#define MAX_SLAB_CLASSES					8
+#define SLAB_SIZE							(256 * 1024)
 #define CONST_COUNT   						4
 
 /* 10,000 entries -> ~6 MB file */
@@ -97,6 +119,8 @@ static mpfr_rnd_t 	STD_RND 				= MPFR_RNDN;
 
 /* precision for float: 24, double: 53*/
 static mpfr_prec_t	clo_precision 			= 120;
+/* precision of the check lane, 0 for none */
+static mpfr_prec_t	clo_checkPrecision		= 0;
 static Bool 		clo_computeMeanValue 	= True;
 static Bool 		clo_ignoreLibraries 	= False;
 static Bool 		clo_ignoreAccurate 		= True;
@@ -104,6 +128,13 @@ static Bool			clo_simulateOriginal	= False;
 static Bool			clo_analyze				= True;
 static Bool			clo_bad_cancellations	= True;
 static Bool			clo_ignore_end			= False;
+static Long			clo_max_shadow_mb		= 0;
+static ShadowBackend	clo_shadowBackend		= Sb_MPFR;
+static Bool			clo_adaptivePrecision	= False;
+static Int			clo_samples				= 3;
+static Char*		clo_precisionFile		= NULL;
+static Bool			clo_exactSums			= False;
+static Bool			clo_skipIntBlocks		= True;
 
 static UInt activeStages 					= 0;
 static ULong sbExecuted 					= 0;
@@ -122,30 +153,102 @@ static UInt loadsIgnored					= 0;
 static UInt putCount 						= 0;
 static UInt putsIgnored 					= 0;
 static UInt maxTemps 						= 0;
+static UInt intBlocks 						= 0;
+static UInt moveBlocks 						= 0;
+
+/* --precision=<number>[,<number>], the second one is for the check lane */
+static Bool parsePrecision(Char* str) {
+	Char* end;
+	Long prec = VG_(strtoll10)(str, &end);
+	if (end == str || prec < MPFR_PREC_MIN || prec > MPFR_PREC_MAX) {
+		return False;
+	}
+	clo_precision = prec;
+	clo_checkPrecision = 0;
+
+	if (*end == ',') {
+		str = end + 1;
+		prec = VG_(strtoll10)(str, &end);
+		if (end == str || prec < MPFR_PREC_MIN || prec > MPFR_PREC_MAX) {
+			return False;
+		}
+		clo_checkPrecision = prec;
+	}
+	return *end == '\0';
+}
 
 static Bool fd_process_cmd_line_option(Char* arg) {
-	if VG_BINT_CLO(arg, "--precision", clo_precision, MPFR_PREC_MIN, MPFR_PREC_MAX) {}
+	Char* backend;
+	Char* precision;
+
+	if VG_STR_CLO(arg, "--precision", precision) {
+		if (!parsePrecision(precision)) {
+			return False;
+		}
+	}
 	else if VG_BOOL_CLO(arg, "--mean-error", clo_computeMeanValue) {}
 	else if VG_BOOL_CLO(arg, "--ignore-libraries", clo_ignoreLibraries) {}
 	else if VG_BOOL_CLO(arg, "--ignore-accurate", clo_ignoreAccurate) {}
 	else if VG_BOOL_CLO(arg, "--sim-original", clo_simulateOriginal) {}
 	else if VG_BOOL_CLO(arg, "--analyze-all", clo_analyze) {}
     else if VG_BOOL_CLO(arg, "--ignore-end", clo_ignore_end) {}
+	else if VG_BINT_CLO(arg, "--max-shadow-mb", clo_max_shadow_mb, 0, 1024 * 1024) {}
+	else if VG_BOOL_CLO(arg, "--adaptive-precision", clo_adaptivePrecision) {}
+	else if VG_BINT_CLO(arg, "--samples", clo_samples, 2, QD_MAX_PARTS) {}
+	else if VG_STR_CLO(arg, "--precision-file", clo_precisionFile) {}
+	else if VG_BOOL_CLO(arg, "--exact-sums", clo_exactSums) {}
+	else if VG_BOOL_CLO(arg, "--skip-int-blocks", clo_skipIntBlocks) {}
+	else if VG_STR_CLO(arg, "--shadow-backend", backend) {
+		if (VG_(strcmp)(backend, "mpfr") == 0) {
+			clo_shadowBackend = Sb_MPFR;
+		} else if (VG_(strcmp)(backend, "dd") == 0) {
+			clo_shadowBackend = Sb_DD;
+		} else if (VG_(strcmp)(backend, "qd") == 0) {
+			clo_shadowBackend = Sb_QD;
+		} else if (VG_(strcmp)(backend, "stochastic") == 0) {
+			clo_shadowBackend = Sb_STOCH;
+		} else if (VG_(strcmp)(backend, "condition") == 0) {
+			clo_shadowBackend = Sb_COND;
+#if defined(FD_HAVE_F128)
+		} else if (VG_(strcmp)(backend, "f128") == 0) {
+			clo_shadowBackend = Sb_F128;
+#endif
+		} else {
+			return False;
+		}
+	}
 	else 
-		return False;
+		return VG_(replacement_malloc_process_cmd_line_option)(arg);
    
 	return True;
 }
 
 static void fd_print_usage(void) {  
 	VG_(printf)(
-"    --precision=<number>      the precision of the shadow values [120]\n"
+"    --precision=<number>[,<number>]  the precision of the shadow values, a second\n"
+"                              precision computes a check lane and reports the\n"
+"                              operations where its errors differ [120]\n"
+"    --precision-file=<file>   precisions per function, source file, address range\n"
+"                              and for float and double operations [none]\n"
 "    --mean-error=no|yes       compute mean and max error for each operation [yes]\n"
 "    --ignore-libraries=no|yes libraries are not analyzed [no]\n"
 "    --ignore-accurate=no|yes  do not show variables/lines without errors [yes]\n"
 "    --sim-original=no|yes     simulate original precision [no]\n"
 "    --analyze-all=no|yes      analyze everything [yes]\n"
 "    --ignore-end=no|yes       ignore end requests [no]\n"
+"    --max-shadow-mb=<number>  limit for the shadow values in MB, 0 for no limit [0]\n"
+"    --shadow-backend=mpfr|dd|qd|f128|stochastic|condition  arithmetic of the\n"
+"                              shadow values, double-double, quad-double and\n"
+"                              binary128 fix the precision to 106, 212 and 113,\n"
+"                              stochastic rounds samples of the original precision\n"
+"                              at random, condition propagates error bounds [mpfr]\n"
+"    --samples=<number>        samples of the stochastic backend, 2 to 4 [3]\n"
+"    --adaptive-precision=no|yes  use double-double until cancellations need\n"
+"                              the precision of MPFR [no]\n"
+"    --exact-sums=no|yes       keep sums that a loop adds up in exact accumulators\n"
+"                              instead of MPFR [no]\n"
+"    --skip-int-blocks=no|yes  blocks without floating-point data only drop\n"
+"                              the shadow values they overwrite [yes]\n"
 	);
 }
 
@@ -153,23 +256,65 @@ static void fd_print_debug_usage(void) {
 	VG_(printf)("    (none)\n");
 }
 
-/* hash tables for maping the addresses of the original floating-point values 
-   to the shadow values */
-static VgHashTable globalMemory 	= NULL;
+/* two-level map for maping the addresses of the original floating-point values
+   to the shadow values (see fd_include.h) */
+#define N_PRIMARY_BITS						20
+#define N_PRIMARY_MAP						(1 << N_PRIMARY_BITS)
+#define MAX_PRIMARY_ADDRESS					((Addr)((((ULong)1) << (SM_BITS + N_PRIMARY_BITS)) - 1))
+
+static ShadowSecMap*	primaryMap[N_PRIMARY_MAP];
+/* Shadow values of the memory per region, the 4 KB pages are hashed into
+   the regions by the lower bits of their number. The instrumentation tests
+   the counter of an address inline and only calls the helper if it is not
+   zero, see shadowMemGuard. */
+#define SHADOW_REGION_BITS					16
+#define SHADOW_REGIONS						(1 << SHADOW_REGION_BITS)
+static UInt				shadowRegions[SHADOW_REGIONS];
+static VgHashTable		auxSecMaps 		= NULL;
+static ShadowSecMap*	allSecMaps		= NULL;
+static ULong 			secMapCount		= 0;
+static ULong 			shadowMemCount	= 0;
+/* bytes of all shadow values in use and all secondary maps */
+static ULong 			shadowBytes		= 0;
+static ULong 			shadowEvicted	= 0;
+static VgHashTable		shadowEvictions	= NULL;
+static VgHashTable		heapBlocks		= NULL;
+static ULong 			shadowDropped	= 0;
+static ULong 			shadowCopied	= 0;
+/* moves of shadow values that share the data instead of copying it */
+static ULong 			sharedCopies	= 0;
+/* operations with an exact result that did not need MPFR */
+static ULong 			exactOps		= 0;
+/* doubles in the parts of shadow data, 0 for the MPFR backend */
+static Int				shadowParts		= 0;
+/* sites computed with MPFR because of --adaptive-precision */
+static VgHashTable		promotedSites	= NULL;
+static VgHashTable		laneSites		= NULL;
+/* rules of --precision-file in the order of the file, NULL without it */
+static XArray*			precisionRules	= NULL;
+static mpfr_prec_t		floatPrecision	= 0;
+static mpfr_prec_t		doublePrecision	= 0;
+/* the largest precision of all operations, for the arguments */
+static mpfr_prec_t		maxPrecision	= 0;
+static ULong			promotedOps		= 0;
+/* sites of --exact-sums and the operations done in their accumulators */
+static VgHashTable		accSites		= NULL;
+static ULong			accOps			= 0;
+static ULong			accInPlace		= 0;
+
 static VgHashTable meanValues 		= NULL;
 static OSet* originAddrSet 			= NULL;
 static OSet* unsupportedOps			= NULL;
 
-static Store* 			storeArgs 	= NULL;
-static Mux0X* 			muxArgs 	= NULL;
-static UnOp* 			unOpArgs 	= NULL;
-static BinOp* 			binOpArgs 	= NULL;
-static TriOp* 			triOpArgs 	= NULL;
-static CircularRegs* 	circRegs	= NULL;
+/* descriptors of the instrumented operations, see OpDesc */
+static VgHashTable		opDescs		= NULL;
 
-static ShadowValue* 	threadRegisters[VG_N_THREADS][MAX_REGISTERS];
 static ShadowValue* 	localTemps[MAX_TEMPS];
-static ShadowTmp* 		sTmp[TMP_COUNT];
+/* sbExecuted when the temporary got its shadow value, for the inline test
+   of the instrumentation, see tempGuard */
+static ULong			tempShadowed[MAX_TEMPS];
+/* the arguments of the operation in its helper, set by setArgBits */
+static ShadowTmp 		sTmp[TMP_COUNT];
 static ShadowConst* 	sConst[CONST_COUNT];
 static Stage* 			stages[MAX_STAGES];
 static StageReport*		stageReports[MAX_STAGES];
@@ -187,7 +332,11 @@ static mpfr_t introMaxError, introErr1, introErr2;
 static mpfr_t compareIntroErr1, compareIntroErr2;
 static mpfr_t writeSvOrg, writeSvDiff, writeSvRelError;
 static mpfr_t cancelTemp;
+static mpfr_t partsTemp;
 static mpfr_t arg1tmpX, arg2tmpX, arg3tmpX;
+static mpfr_t arg1laneX, arg2laneX, arg3laneX;
+static mpfr_t laneRelError;
+static mpfr_t accTemp, accValue;
 
 
 static Char* mpfrToStringShort(Char* str, mpfr_t* fp) {
@@ -321,223 +470,1363 @@ mpfr_exp_t getCanceledBits(mpfr_t* res, mpfr_t* arg1, mpfr_t* arg2) {
 	return 0;
 }
 
-static ULong avMallocs = 0;
-static ULong avFrees = 0;
+/* Shadow values are allocated from slabs. The limbs of the MPFR value are
+   stored directly behind the shadow data with the custom interface of MPFR,
+   so a value needs neither a malloc for the struct nor one for the limbs.
+   The shadow values of the locations have a slab class of their own. */
+static SlabClass		slabClasses[MAX_SLAB_CLASSES];
+static Int				numSlabClasses	= 0;
+static SlabClass		locationSlab;
+static SlabClass		accSlab;
+
+static void initSlabClass(SlabClass* sc, mpfr_prec_t prec, SizeT objSize) {
+	sc->prec = prec;
+	sc->objSize = objSize;
+	sc->freeList = NULL;
+	sc->cur = NULL;
+	sc->end = NULL;
+	sc->slabs = 0;
+	sc->inUse = 0;
+	sc->maxInUse = 0;
+}
 
+/* With a second precision, the check lane follows the limbs of value in
+   the same object, first its struct and then its limbs. */
 static __inline__
-ShadowValue* initShadowValue(UWord key) {
-	ShadowValue* sv = VG_(malloc)("fd.initShadowValue.1", sizeof(ShadowValue));
-	sv->key = key;
-	sv->active = True;
-	sv->version = 0;
-	sv->opCount = 0;
-	sv->origin = 0;
-	sv->cancelOrigin = 0;
-	sv->orgType = Ot_INVALID;
+SizeT checkLaneSize(void) {
+	if (clo_checkPrecision == 0) {
+		return 0;
+	}
+	return sizeof(__mpfr_struct) + mpfr_custom_get_size(clo_checkPrecision);
+}
 
-	mpfr_init(sv->value);
+static SlabClass* getSlabClass(mpfr_prec_t prec, Int* index) {
+	Int i;
+	for (i = 0; i < numSlabClasses; i++) {
+		if (slabClasses[i].prec == prec) {
+			*index = i;
+			return &(slabClasses[i]);
+		}
+	}
+	tl_assert(numSlabClasses < MAX_SLAB_CLASSES);
 
-	avMallocs++;
-	return sv;
+	SlabClass* sc = &(slabClasses[numSlabClasses]);
+	/* the size of the struct is a multiple of the limb size, hence the limbs are aligned */
+	initSlabClass(sc, prec, sizeof(ShadowData) + mpfr_custom_get_size(prec) + checkLaneSize());
+	*index = numSlabClasses++;
+	return sc;
 }
 
-static __inline__
-void freeShadowValue(ShadowValue* sv, Bool freeSvItself) {
-	tl_assert(sv != NULL);
+static void* slabAlloc(SlabClass* sc, Bool* fresh) {
+	void* obj;
 
-	mpfr_clear(sv->value);
-	if (freeSvItself) {
-		VG_(free)(sv);
+	if (sc->freeList) {
+		obj = sc->freeList;
+		sc->freeList = *(void**)obj;
+		*fresh = False;
+	} else {
+		if (sc->cur + sc->objSize > sc->end) {
+			sc->cur = VG_(malloc)("fd.slabAlloc.1", SLAB_SIZE);
+			sc->end = sc->cur + SLAB_SIZE;
+			sc->slabs++;
+		}
+		obj = sc->cur;
+		sc->cur += sc->objSize;
+		*fresh = True;
+	}
+
+	sc->inUse++;
+	shadowBytes += sc->objSize;
+	if (sc->inUse > sc->maxInUse) {
+		sc->maxInUse = sc->inUse;
 	}
-	avFrees++;
+	return obj;
 }
 
-static __inline__
-void copyShadowValue(ShadowValue* newSv, ShadowValue* sv) {
-	tl_assert(newSv != NULL && sv != NULL);
+/* The cold parts of shadow data and shadow values. A slot is assigned
+   when an object is carved from a slab. */
+static ColdArray		dataColdArray	= { sizeof(ShadowDataCold), NULL, 0, 0 };
+static ColdArray		valueColdArray	= { sizeof(ShadowValueCold), NULL, 0, 0 };
 
-	if (clo_simulateOriginal) {
-		mpfr_set_prec(newSv->value, mpfr_get_prec(sv->value));
+static UInt newColdSlot(ColdArray* ca) {
+	if (ca->used == ca->size) {
+		UInt size = ca->size > 0 ? 2 * ca->size : 1024;
+		if (ca->elems) {
+			ca->elems = VG_(realloc)("fd.newColdSlot.1", ca->elems, size * ca->elemSize);
+		} else {
+			ca->elems = VG_(malloc)("fd.newColdSlot.2", size * ca->elemSize);
+		}
+		shadowBytes += (size - ca->size) * ca->elemSize;
+		ca->size = size;
 	}
+	return ca->used++;
+}
 
-	mpfr_set(newSv->value, sv->value, STD_RND);
-	newSv->opCount = sv->opCount;
-	newSv->origin = sv->origin;
-	newSv->canceled = sv->canceled;
-	newSv->cancelOrigin = sv->cancelOrigin;
-	newSv->orgType = Ot_INVALID;
-
-	/* Do not overwrite active or version!
-	   They should be set before. */
+/* The arrays may move when they grow, so the pointers are not kept. */
+static __inline__
+ShadowDataCold* dataCold(ShadowData* d) {
+	return (ShadowDataCold*)dataColdArray.elems + d->cold;
 }
 
 static __inline__
-ShadowValue* getTemp(IRTemp tmp) {
-	tl_assert(tmp >= 0 && tmp < MAX_TEMPS);
+ShadowValueCold* svCold(ShadowValue* sv) {
+	return (ShadowValueCold*)valueColdArray.elems + sv->cold;
+}
 
-	if (localTemps[tmp] && localTemps[tmp]->version == sbExecuted) {
-		return localTemps[tmp];
-	} else {
-		return NULL;
-	}
+static void slabFree(SlabClass* sc, void* obj) {
+	tl_assert(sc->inUse > 0);
+
+	*(void**)obj = sc->freeList;
+	sc->freeList = obj;
+	sc->inUse--;
+	shadowBytes -= sc->objSize;
 }
 
+/* Precision of the shadow values. It is at least 53 bits, so that the
+   native values of exact results always fit. */
 static __inline__
-ShadowValue* setTemp(IRTemp tmp) {
-	tl_assert(tmp >= 0 && tmp < MAX_TEMPS);
+mpfr_prec_t shadowPrec(void) {
+	return clo_precision > 53 ? clo_precision : 53;
+}
 
-	if (localTemps[tmp]) {
-		localTemps[tmp]->active = True;
-	} else {
-		localTemps[tmp] = initShadowValue((UWord)tmp);
+/* Precision of the shadow values of the operation at addr, resolved when
+   it is instrumented. The first matching rule of --precision-file is
+   used, otherwise the default for float or double operations. */
+static mpfr_prec_t sitePrecision(Addr addr, Bool isFloat) {
+	Char name[DESCRIPTION_SIZE];
+	Word i;
+
+	if (precisionRules == NULL) {
+		return shadowPrec();
+	}
+	for (i = 0; i < VG_(sizeXA)(precisionRules); i++) {
+		PrecisionRule* rule = VG_(indexXA)(precisionRules, i);
+		switch (rule->kind) {
+			case Pr_RANGE:
+				if (addr >= rule->start && addr <= rule->end) {
+					return rule->prec;
+				}
+				break;
+			case Pr_FUN:
+				if (VG_(get_fnname)(addr, name, DESCRIPTION_SIZE) && VG_(string_match)(rule->pattern, name)) {
+					return rule->prec;
+				}
+				break;
+			case Pr_FILE:
+				if (VG_(get_filename)(addr, name, DESCRIPTION_SIZE) && VG_(string_match)(rule->pattern, name)) {
+					return rule->prec;
+				}
+				break;
+		}
 	}
-	localTemps[tmp]->version = sbExecuted;
+	return isFloat ? floatPrecision : doublePrecision;
+}
 
-	return localTemps[tmp];
+static Char* nextToken(Char** p) {
+	Char* tok;
+	while (**p == ' ' || **p == '\t') {
+		(*p)++;
+	}
+	if (**p == '\0' || **p == '#') {
+		return NULL;
+	}
+	tok = *p;
+	while (**p != '\0' && **p != ' ' && **p != '\t') {
+		(*p)++;
+	}
+	if (**p != '\0') {
+		**p = '\0';
+		(*p)++;
+	}
+	return tok;
 }
 
-static void updateMeanValue(UWord key, IROp op, mpfr_t* shadow, mpfr_exp_t canceled, Addr arg1, Addr arg2, UInt cancellationBadness) {
-	if (mpfr_cmp_ui(meanOrg, 0) != 0 || mpfr_cmp_ui(*shadow, 0) != 0) {
-		mpfr_reldiff(meanRelError, *shadow, meanOrg, STD_RND);
-		mpfr_abs(meanRelError, meanRelError, STD_RND);
-	} else {
-		mpfr_set_ui(meanRelError, 0, STD_RND);
+/* like shadowPrec, at least 53 bits */
+static Bool parseRulePrecision(Char* tok, mpfr_prec_t* prec) {
+	Char* end;
+	Long bits;
+	if (tok == NULL) {
+		return False;
+	}
+	bits = VG_(strtoll10)(tok, &end);
+	if (end == tok || *end != '\0' || bits < MPFR_PREC_MIN || bits > MPFR_PREC_MAX) {
+		return False;
 	}
+	*prec = bits > 53 ? bits : 53;
+	if (*prec > maxPrecision) {
+		maxPrecision = *prec;
+	}
+	return True;
+}
 
-	MeanValue* val = VG_(HT_lookup)(meanValues, key);
-	if (val == NULL) {
-		val = VG_(malloc)("fd.updateMeanValue.1", sizeof(MeanValue));
-		val->key = key;
-		val->op = op;
-		val->count = 1;
-		val->visited = False;
-		val->overflow = False;
-		mpfr_init_set(val->sum, meanRelError, STD_RND);
-		mpfr_init_set(val->max, meanRelError, STD_RND);
-		val->canceledSum = canceled;
-		val->canceledMax = canceled;
-		val->cancellationBadnessSum = cancellationBadness;
-		val->cancellationBadnessMax = cancellationBadness;
-		VG_(HT_add_node)(meanValues, val);
-		val->arg1 = arg1;
-		val->arg2 = arg2;
+/* One rule per line, '#' starts a comment:
+     float <bits>                 default for float operations
+     double <bits>                default for double operations
+     fun <pattern> <bits>         functions
+     file <pattern> <bits>        source files
+     range <start>-<end> <bits>   instruction addresses in hex */
+static Bool parsePrecisionRule(Char* line) {
+	PrecisionRule rule;
+	Char* end;
+	Char* kind = nextToken(&line);
+	Char* arg = nextToken(&line);
+
+	if (kind == NULL) {
+		return True;
+	}
+	if (VG_(strcmp)(kind, "float") == 0) {
+		return parseRulePrecision(arg, &floatPrecision) && nextToken(&line) == NULL;
+	}
+	if (VG_(strcmp)(kind, "double") == 0) {
+		return parseRulePrecision(arg, &doublePrecision) && nextToken(&line) == NULL;
+	}
+
+	if (arg == NULL || !parseRulePrecision(nextToken(&line), &(rule.prec)) || nextToken(&line) != NULL) {
+		return False;
+	}
+	rule.pattern = NULL;
+	rule.start = 0;
+	rule.end = 0;
+	if (VG_(strcmp)(kind, "fun") == 0) {
+		rule.kind = Pr_FUN;
+		rule.pattern = VG_(strdup)("fd.parsePrecisionRule.1", arg);
+	} else if (VG_(strcmp)(kind, "file") == 0) {
+		rule.kind = Pr_FILE;
+		rule.pattern = VG_(strdup)("fd.parsePrecisionRule.2", arg);
+	} else if (VG_(strcmp)(kind, "range") == 0) {
+		rule.kind = Pr_RANGE;
+		rule.start = (Addr)VG_(strtoll16)(arg, &end);
+		if (end == arg || *end != '-') {
+			return False;
+		}
+		arg = end + 1;
+		rule.end = (Addr)VG_(strtoll16)(arg, &end);
+		if (end == arg || *end != '\0' || rule.end < rule.start) {
+			return False;
+		}
 	} else {
-		val->count++;
-		mpfr_add(val->sum, val->sum, meanRelError, STD_RND);
+		return False;
+	}
+	VG_(addToXA)(precisionRules, &rule);
+	return True;
+}
 
-		mpfr_exp_t oldSum = val->canceledSum;
-		val->canceledSum += canceled;
-		/* check for overflow */
-		if (oldSum > val->canceledSum) {
-			val->overflow = True;
+/* every precision needs its own slab class */
+static Bool reserveSlabClass(mpfr_prec_t prec) {
+	Int i;
+	for (i = 0; i < numSlabClasses; i++) {
+		if (slabClasses[i].prec == prec) {
+			return True;
 		}
+	}
+	if (numSlabClasses == MAX_SLAB_CLASSES) {
+		return False;
+	}
+	getSlabClass(prec, &i);
+	return True;
+}
 
-		val->cancellationBadnessSum += cancellationBadness;
+static void readPrecisionFile(Char* fname) {
+	SysRes fileRes = VG_(open)(fname, VKI_O_RDONLY, 0);
+	if (sr_isError(fileRes)) {
+		VG_(umsg)("PRECISION FILE (%s): Failed to open the file!\n", fname);
+		VG_(exit)(1);
+	}
+	Int file = sr_Res(fileRes);
 
-		if (mpfr_cmp(meanRelError, val->max) > 0) {
-			mpfr_set(val->max, meanRelError, STD_RND);
-			val->arg1 = arg1;
-			val->arg2 = arg2;
+	Int size = 4096;
+	Int len = 0;
+	Int n;
+	Char* buf = VG_(malloc)("fd.readPrecisionFile.1", size + 1);
+	while ((n = VG_(read)(file, buf + len, size - len)) > 0) {
+		len += n;
+		if (len == size) {
+			size *= 2;
+			buf = VG_(realloc)("fd.readPrecisionFile.2", buf, size + 1);
 		}
-
-		if (canceled > val->canceledMax) {
-			val->canceledMax = canceled;
+	}
+	VG_(close)(file);
+	buf[len] = '\0';
+
+	floatPrecision = shadowPrec();
+	doublePrecision = shadowPrec();
+	maxPrecision = shadowPrec();
+	precisionRules = VG_(newXA)(VG_(malloc), "fd.readPrecisionFile.3", VG_(free), sizeof(PrecisionRule));
+
+	Char* line = buf;
+	Int lineNo = 1;
+	while (line) {
+		Char* next = VG_(strchr)(line, '\n');
+		if (next) {
+			*next++ = '\0';
 		}
-
-		if (cancellationBadness > val->cancellationBadnessMax) {
-			val->cancellationBadnessMax = cancellationBadness;
+		if (!parsePrecisionRule(line)) {
+			VG_(umsg)("PRECISION FILE (%s): invalid rule in line %d\n", fname, lineNo);
+			VG_(exit)(1);
 		}
+		line = next;
+		lineNo++;
+	}
+	VG_(free)(buf);
+
+	Word i;
+	Bool reserved = reserveSlabClass(floatPrecision) && reserveSlabClass(doublePrecision);
+	for (i = 0; reserved && i < VG_(sizeXA)(precisionRules); i++) {
+		reserved = reserveSlabClass(((PrecisionRule*)VG_(indexXA)(precisionRules, i))->prec);
+	}
+	if (!reserved) {
+		VG_(umsg)("PRECISION FILE (%s): more than %d different precisions\n", fname, MAX_SLAB_CLASSES);
+		VG_(exit)(1);
 	}
 }
 
-static void stageClearVals(VgHashTable t) {
-	if (t == NULL) {
+static __inline__
+mpfr_ptr checkLane(ShadowData* d) {
+	return (mpfr_ptr)((Char*)(d + 1) + mpfr_custom_get_size(slabClasses[d->slabClass].prec));
+}
+
+/* the parts of the backends other than MPFR, at the place of the limbs */
+static __inline__
+Double* dataParts(ShadowData* d) {
+	return (Double*)(d + 1);
+}
+
+/* the accumulator of --exact-sums, its pointer is kept at the place of the limbs */
+static __inline__
+Accumulator* dataAcc(ShadowData* d) {
+	return *(Accumulator**)(d + 1);
+}
+
+static __inline__
+ShadowData* newShadowData(mpfr_prec_t prec) {
+	Int index;
+	Bool fresh;
+	ShadowData* d = slabAlloc(getSlabClass(prec, &index), &fresh);
+	if (fresh) {
+		d->cold = newColdSlot(&dataColdArray);
+		dataCold(d)->data = d;
+	}
+	d->refCount = 1;
+	d->slabClass = (UChar)index;
+	dataCold(d)->opCount = 0;
+	dataCold(d)->origin = 0;
+	dataCold(d)->canceled = 0;
+	dataCold(d)->cancelOrigin = 0;
+	d->repr = Sr_MPFR;
+	d->hasValue = True;
+	mpfr_custom_init(d + 1, prec);
+	mpfr_custom_init_set(d->value, MPFR_NAN_KIND, 0, prec, d + 1);
+	if (clo_checkPrecision > 0) {
+		mpfr_ptr lane = checkLane(d);
+		mpfr_custom_init(lane + 1, clo_checkPrecision);
+		mpfr_custom_init_set(lane, MPFR_NAN_KIND, 0, clo_checkPrecision, lane + 1);
+	}
+	return d;
+}
+
+static __inline__
+void releaseShadowData(ShadowData* d) {
+	if (d == NULL) {
 		return;
 	}
-
-	VG_(HT_ResetIter)(t);
-	StageValue* next;
-	while (next = VG_(HT_Next)(t)) {
-		mpfr_clears(next->val, next->relError, NULL);
+	tl_assert(d->refCount > 0);
+	d->refCount--;
+	if (d->refCount == 0) {
+		if (d->repr == Sr_ACC) {
+			slabFree(&accSlab, dataAcc(d));
+		}
+		slabFree(&(slabClasses[d->slabClass]), d);
 	}
-	VG_(HT_destruct)(t);
 }
 
-static void stageStart(Int num) {
-	tl_assert(num < MAX_STAGES);
-	
-	if (stages[num]) {
-		tl_assert(!stages[num]->active);
-		stages[num]->active = True;
-		stages[num]->count++;
-	} else {
-		stages[num] = VG_(malloc)("fd.stageStart.1", sizeof(Stage));
-		stages[num]->active = True;
-		stages[num]->count = 1;
-		stages[num]->oldVals = NULL;
-		stages[num]->limits = VG_(HT_construct)("Stage limits");
+static __inline__
+ShadowValue* initShadowValue(UWord key) {
+	Bool fresh;
+	ShadowValue* sv = slabAlloc(&locationSlab, &fresh);
+	if (fresh) {
+		sv->cold = newColdSlot(&valueColdArray);
 	}
-	stages[num]->newVals = VG_(HT_construct)("Stage values");
-	activeStages++;
+	sv->key = key;
+	sv->active = True;
+	sv->referenced = False;
+	sv->version = 0;
+	svCold(sv)->orgType = Ot_INVALID;
+	sv->data = NULL;
+	return sv;
 }
 
-static void stageEnd(Int num) {
-	tl_assert(stages[num]);
-	tl_assert(stages[num]->active);
+static __inline__
+void freeShadowValue(ShadowValue* sv) {
+	tl_assert(sv != NULL);
+	releaseShadowData(sv->data);
+	slabFree(&locationSlab, sv);
+}
 
-	Int mateCount = -1;
-	Int newNodes = 0;
-	Int oldNodes = 0;
+static __inline__
+void setExact(ShadowData* d, Double native) {
+	d->repr = Sr_EXACT;
+	d->hasValue = False;
+	d->native = native;
+}
 
-	if (stages[num]->newVals && stages[num]->oldVals) {
-		mateCount = 0;
+/* the parts are written by the caller */
+static __inline__
+void setParts(ShadowData* d) {
+	d->repr = Sr_PARTS;
+	d->hasValue = False;
+}
 
-		VG_(HT_ResetIter)(stages[num]->newVals);
-		StageValue* next;
-		StageValue* mate;
+static __inline__
+void setAcc(ShadowData* d, Accumulator* acc) {
+	d->repr = Sr_ACC;
+	d->hasValue = False;
+	*(Accumulator**)(d + 1) = acc;
+	accOps++;
+}
 
-		while (next = VG_(HT_Next)(stages[num]->newVals)) {
-			mate = VG_(HT_lookup)(stages[num]->oldVals, next->key);
-			if (!mate) {
-				VG_(dmsg)("no mate: %d\n", num);
-				continue;
-			}
+/* Arithmetic on the parts, for the double-double and quad-double backends
+   with fd_qd.c, for the binary128 backend with fd_f128.c, for the samples
+   of the stochastic backend with fd_stoch.c and for the error bounds with
+   fd_cond.c. Only the last two round to the precision of the operation
+   given by isFloat. The operations of the backend are selected once in
+   fd_post_clo_init. */
+static const PartsOps* partsOps = &qdOps;
 
-			mateCount++;
-			StageLimit* sl = VG_(HT_lookup)(stages[num]->limits, next->key);
+static __inline__
+void partsSetDouble(Double x, Double* r) {
+	partsOps->setDouble(shadowParts, x, r);
+}
 
-			mpfr_sub(stageDiff, mate->relError, next->relError, STD_RND);
-			mpfr_abs(stageDiff, stageDiff, STD_RND);
+static __inline__
+void partsAdd(Bool isFloat, const Double* a, const Double* b, Double* r) {
+	partsOps->add(shadowParts, isFloat, a, b, r);
+}
 
-			Char mpfrBuf[MPFR_BUFSIZE];
-			if (sl) {
-				if (mpfr_cmp(stageDiff, sl->limit) > 0) {
-					mpfrToString(mpfrBuf, &(sl->limit));
-					mpfrToString(mpfrBuf, &(stageDiff));
+static __inline__
+void partsSub(Bool isFloat, const Double* a, const Double* b, Double* r) {
+	partsOps->sub(shadowParts, isFloat, a, b, r);
+}
 
-					/* adjust limit for the following iterations */
-					mpfr_set(sl->limit, stageDiff, STD_RND);
+static __inline__
+void partsMul(Bool isFloat, const Double* a, const Double* b, Double* r) {
+	partsOps->mul(shadowParts, isFloat, a, b, r);
+}
 
-					/* create stage report */
-					StageReport* report = NULL;
-					if (stageReports[num]) {
-						report = VG_(HT_lookup)(stageReports[num], next->key);
-					} else {
-						stageReports[num] = VG_(HT_construct)("Stage reports");
-					}
-					if (report) {
-						report->count++;
-						report->iterMax = stages[num]->count;
-					} else {
-						report = VG_(malloc)("fd.stageEnd.1", sizeof(StageReport));
-						report->key = next->key;
-						report->count = 1;
-						report->iterMin = stages[num]->count;
-						report->iterMax = stages[num]->count;
-						report->origin = 0;
-						ShadowValue* sv = VG_(HT_lookup)(globalMemory, next->key);
-						if (sv) {
-							report->origin = sv->origin;
+static __inline__
+void partsDiv(Bool isFloat, const Double* a, const Double* b, Double* r) {
+	partsOps->div(shadowParts, isFloat, a, b, r);
+}
+
+static __inline__
+void partsSqrt(Bool isFloat, const Double* a, Double* r) {
+	partsOps->sqrt(shadowParts, isFloat, a, r);
+}
+
+static __inline__
+void partsNeg(const Double* a, Double* r) {
+	partsOps->neg(shadowParts, a, r);
+}
+
+static __inline__
+void partsAbs(const Double* a, Double* r) {
+	partsOps->abs(shadowParts, a, r);
+}
+
+static __inline__
+void partsMinMax(const Double* a, const Double* b, Bool max, Double* r) {
+	partsOps->minMax(shadowParts, a, b, max, r);
+}
+
+/* exponent as returned by mpfr_get_exp, False for zero, subnormals,
+   infinity and NaN, the first sample for the stochastic backend */
+static __inline__
+Bool partsExp(const Double* a, mpfr_exp_t* e) {
+#if defined(FD_HAVE_F128)
+	if (clo_shadowBackend == Sb_F128) {
+		Long exp;
+		if (!f128Exp(a, &exp)) {
+			return False;
+		}
+		*e = exp;
+		return True;
+	}
+#endif
+	if (!isRegularDouble(a[0])) {
+		return False;
+	}
+	*e = nativeExp(a[0]);
+	return True;
+}
+
+/* a == x, the first sample for the stochastic backend */
+static __inline__
+Bool partsEqualDouble(const Double* a, Double x) {
+#if defined(FD_HAVE_F128)
+	if (clo_shadowBackend == Sb_F128) {
+		return loadF128(a) == x;
+	}
+#endif
+	return a[0] == x;
+}
+
+/* |(a - org) / a|, the stochastic backend estimates the error from the
+   spread of the samples instead and the condition backend has a bound */
+static Double partsRelError(const Double* a, Double org) {
+	Double orgParts[QD_MAX_PARTS];
+	Double diff[QD_MAX_PARTS];
+
+	if (clo_shadowBackend == Sb_STOCH) {
+		return stochRelError(shadowParts, a);
+	}
+	if (clo_shadowBackend == Sb_COND) {
+		return a[COND_ERROR];
+	}
+#if defined(FD_HAVE_F128)
+	if (clo_shadowBackend == Sb_F128) {
+		return f128RelError(a, org);
+	}
+#endif
+	if (org == 0 && a[0] == 0) {
+		return 0;
+	}
+	qdSetSpecial(shadowParts, org, orgParts);
+	qdSub(shadowParts, a, orgParts, diff);
+	return absDouble(diff[0] / a[0]);
+}
+
+/* the stochastic backend gives the mean of the samples, the condition
+   backend the value without the error bound */
+static void partsToMpfr(const Double* x, mpfr_t* fp) {
+	Int i;
+
+	if (clo_shadowBackend == Sb_COND) {
+		mpfr_set_d(*fp, x[COND_VALUE], STD_RND);
+		return;
+	}
+
+	if (clo_shadowBackend == Sb_STOCH) {
+		mpfr_set_d(*fp, x[0], STD_RND);
+		for (i = 1; i < shadowParts; i++) {
+			mpfr_add_d(*fp, *fp, x[i], STD_RND);
+		}
+		mpfr_div_ui(*fp, *fp, shadowParts, STD_RND);
+		return;
+	}
+#if defined(FD_HAVE_F128)
+	if (clo_shadowBackend == Sb_F128) {
+		Float128 m = loadF128(x);
+		Double hi, mid, lo;
+		Int e;
+		if (m == 0 || f128ExpBits(m) == F128_MAX_EXP) {
+			mpfr_set_d(*fp, (Double)m, STD_RND);
+			return;
+		}
+		m = f128Frexp(m, &e);
+		f128Split(m, &hi, &mid, &lo);
+		mpfr_set_d(*fp, hi, STD_RND);
+		mpfr_add_d(*fp, *fp, mid, STD_RND);
+		mpfr_add_d(*fp, *fp, lo, STD_RND);
+		mpfr_mul_2si(*fp, *fp, e, STD_RND);
+		return;
+	}
+#endif
+	mpfr_set_d(*fp, x[0], STD_RND);
+	for (i = 1; i < shadowParts && x[i] != 0; i++) {
+		mpfr_add_d(*fp, *fp, x[i], STD_RND);
+	}
+}
+
+static void mpfrToParts(mpfr_t* fp, Double* x) {
+	Int i;
+
+	if (clo_shadowBackend == Sb_STOCH) {
+		stochSetDouble(shadowParts, mpfr_get_d(*fp, STD_RND), x);
+		return;
+	}
+	if (clo_shadowBackend == Sb_COND) {
+		condSetDouble(shadowParts, mpfr_get_d(*fp, STD_RND), x);
+		return;
+	}
+#if defined(FD_HAVE_F128)
+	if (clo_shadowBackend == Sb_F128) {
+		Double hi, mid, lo;
+		mpfr_exp_t e;
+		if (mpfr_regular_p(*fp) == 0) {
+			f128SetDouble(shadowParts, mpfr_get_d(*fp, STD_RND), x);
+			return;
+		}
+		/* the mantissa in [0.5, 1) fits into three doubles */
+		e = mpfr_get_exp(*fp);
+		mpfr_mul_2si(partsTemp, *fp, -e, STD_RND);
+		hi = mpfr_get_d(partsTemp, STD_RND);
+		mpfr_sub_d(partsTemp, partsTemp, hi, STD_RND);
+		mid = mpfr_get_d(partsTemp, STD_RND);
+		mpfr_sub_d(partsTemp, partsTemp, mid, STD_RND);
+		lo = mpfr_get_d(partsTemp, STD_RND);
+		storeF128(x, f128Ldexp((Float128)hi + mid + lo, e));
+		return;
+	}
+#endif
+	x[0] = mpfr_get_d(*fp, STD_RND);
+	if (!isFiniteDouble(x[0])) {
+		for (i = 1; i < shadowParts; i++) {
+			x[i] = 0;
+		}
+		return;
+	}
+	mpfr_sub_d(partsTemp, *fp, x[0], STD_RND);
+	for (i = 1; i < shadowParts; i++) {
+		x[i] = mpfr_get_d(partsTemp, STD_RND);
+		mpfr_sub_d(partsTemp, partsTemp, x[i], STD_RND);
+	}
+}
+
+/* Rounds the exact sum to the precision of fp. The words are put
+   together without rounding in accTemp first, with only as many bits as
+   the nonzero words have. */
+static void accToMpfr(const Accumulator* acc, mpfr_t* fp) {
+	ULong mag[ACC_WORDS];
+	Int lo, hi, i;
+
+	Bool neg = accMagnitude(acc, mag, &lo, &hi);
+	if (hi < 0) {
+		mpfr_set_ui(*fp, 0, STD_RND);
+		return;
+	}
+	mpfr_set_prec_raw(accTemp, (hi - lo + 1) * 64);
+	mpfr_set_ui(accTemp, 0, STD_RND);
+	for (i = hi; i >= lo; i--) {
+		/* an unsigned long may only have 32 bits */
+		mpfr_mul_2ui(accTemp, accTemp, 32, STD_RND);
+		mpfr_add_ui(accTemp, accTemp, (unsigned long)(mag[i] >> 32), STD_RND);
+		mpfr_mul_2ui(accTemp, accTemp, 32, STD_RND);
+		mpfr_add_ui(accTemp, accTemp, (unsigned long)(mag[i] & 0xFFFFFFFFULL), STD_RND);
+	}
+	mpfr_mul_2si(*fp, accTemp, (long)lo * 64 - ACC_LSB_EXP, STD_RND);
+	if (neg) {
+		mpfr_neg(*fp, *fp, STD_RND);
+	}
+	mpfr_set_prec_raw(accTemp, ACC_WORDS * 64);
+}
+
+/* Splits fp into doubles and adds them to the cleared accumulator. Fails
+   for infinity and NaN and for values out of the range of doubles. */
+static Bool mpfrToAcc(mpfr_t* fp, Accumulator* acc) {
+	Int i;
+
+	accClear(acc);
+	if (!mpfr_number_p(*fp) || mpfr_set(accTemp, *fp, STD_RND) != 0) {
+		return False;
+	}
+	for (i = 0; !mpfr_zero_p(accTemp); i++) {
+		Double x = mpfr_get_d(accTemp, STD_RND);
+		if (x == 0 || !isFiniteDouble(x) || i > mpfr_get_prec(*fp) / 53 + 1) {
+			return False;
+		}
+		accAddDouble(acc, x, False);
+		mpfr_sub_d(accTemp, accTemp, x, STD_RND);
+	}
+	return True;
+}
+
+/* Computes the MPFR value of exact shadow data, of parts or of an
+   accumulator, before it is read. The value does not change, so this is
+   fine for shared data as well. The limbs overwrite the parts or the
+   pointer to the accumulator, afterwards the data is kept in MPFR. */
+static __inline__
+void materialize(ShadowData* d) {
+	Double parts[QD_MAX_PARTS];
+	Int i;
+
+	if (!d->hasValue) {
+		if (d->repr == Sr_EXACT) {
+			mpfr_set_d(d->value, d->native, STD_RND);
+		} else if (d->repr == Sr_ACC) {
+			Accumulator* acc = dataAcc(d);
+			accToMpfr(acc, &(d->value));
+			slabFree(&accSlab, acc);
+			d->repr = Sr_MPFR;
+		} else {
+			for (i = 0; i < shadowParts; i++) {
+				parts[i] = dataParts(d)[i];
+			}
+			partsToMpfr(parts, &(d->value));
+			d->repr = Sr_MPFR;
+		}
+		d->hasValue = True;
+	}
+}
+
+/* The result of an operation always gets new shadow data, the old one
+   may still be shared with other locations. */
+static __inline__
+ShadowData* newResult(ShadowValue* res, mpfr_prec_t prec) {
+	ShadowData* d = newShadowData(prec);
+	releaseShadowData(res->data);
+	res->data = d;
+	return d;
+}
+
+/* The data of a sum updated in place by accumulate becomes the result,
+   the argument that held it is not read anymore. */
+static __inline__
+ShadowData* reuseResult(ShadowValue* res, ShadowData* d) {
+	d->refCount++;
+	releaseShadowData(res->data);
+	res->data = d;
+	return d;
+}
+
+static __inline__
+void setShadowData(ShadowValue* sv, ShadowData* d) {
+	d->refCount++;
+	sharedCopies++;
+	releaseShadowData(sv->data);
+	sv->data = d;
+}
+
+static __inline__
+void copyShadowValue(ShadowValue* newSv, ShadowValue* sv) {
+	tl_assert(newSv != NULL && sv != NULL && sv->data != NULL);
+
+	setShadowData(newSv, sv->data);
+
+	/* Do not overwrite active or version!
+	   They should be set before. The original value is set by
+	   processStore, it is not needed for temporaries and registers. */
+}
+
+static __inline__
+ShadowValue* getTemp(IRTemp tmp) {
+	tl_assert(tmp >= 0 && tmp < MAX_TEMPS);
+
+	if (localTemps[tmp] && localTemps[tmp]->version == sbExecuted) {
+		return localTemps[tmp];
+	} else {
+		return NULL;
+	}
+}
+
+static __inline__
+ShadowValue* setTemp(IRTemp tmp) {
+	tl_assert(tmp >= 0 && tmp < MAX_TEMPS);
+
+	if (localTemps[tmp]) {
+		localTemps[tmp]->active = True;
+	} else {
+		localTemps[tmp] = initShadowValue((UWord)tmp);
+	}
+	localTemps[tmp]->version = sbExecuted;
+	tempShadowed[tmp] = sbExecuted;
+
+	return localTemps[tmp];
+}
+
+static __inline__
+UWord shadowRegion(Addr addr) {
+	return (addr >> SM_PAGE_BITS) & (SHADOW_REGIONS - 1);
+}
+
+static ShadowSecMap* getSecMap(Addr addr, Bool create) {
+	ShadowSecMap* sm;
+	UWord smIndex = addr >> SM_BITS;
+
+	if (addr <= MAX_PRIMARY_ADDRESS) {
+		sm = primaryMap[smIndex];
+	} else {
+		sm = VG_(HT_lookup)(auxSecMaps, smIndex);
+	}
+	if (sm || !create) {
+		return sm;
+	}
+
+	sm = VG_(malloc)("fd.getSecMap.1", sizeof(ShadowSecMap));
+	VG_(memset)(sm, 0, sizeof(ShadowSecMap));
+	sm->key = smIndex;
+	sm->allNext = allSecMaps;
+	allSecMaps = sm;
+	secMapCount++;
+	shadowBytes += sizeof(ShadowSecMap);
+
+	if (addr <= MAX_PRIMARY_ADDRESS) {
+		primaryMap[smIndex] = sm;
+	} else {
+		VG_(HT_add_node)(auxSecMaps, sm);
+	}
+	return sm;
+}
+
+/* Returns the shadow value stored for addr, active or not. Addresses that
+   are not 4-byte aligned share a slot with the aligned address below, hence
+   the key is compared as well. */
+static __inline__
+ShadowValue* getShadowMem(Addr addr) {
+	ShadowSecMap* sm;
+	if (addr <= MAX_PRIMARY_ADDRESS) {
+		sm = primaryMap[addr >> SM_BITS];
+	} else {
+		sm = getSecMap(addr, False);
+	}
+	if (!sm) {
+		return NULL;
+	}
+
+	ShadowValue* sv = sm->slots[(addr & SM_MASK) >> SM_SLOT_SHIFT];
+	if (sv && sv->key == addr) {
+		return sv;
+	}
+	return NULL;
+}
+
+/* Stores sv as the shadow value of addr. An existing shadow value of an
+   unaligned neighbour in the same slot is replaced and freed. */
+static void setShadowMem(Addr addr, ShadowValue* sv) {
+	ShadowSecMap* sm = getSecMap(addr, True);
+	UWord slot = (addr & SM_MASK) >> SM_SLOT_SHIFT;
+
+	ShadowValue* old = sm->slots[slot];
+	if (old == sv) {
+		return;
+	}
+	if (old) {
+		freeShadowValue(old);
+	} else {
+		sm->used++;
+		sm->pageUsed[slot / SM_PAGE_SLOTS]++;
+		shadowRegions[shadowRegion(addr)]++;
+		shadowMemCount++;
+	}
+	sm->slots[slot] = sv;
+}
+
+/* Returns a newly allocated array with all shadow values of the memory. */
+static ShadowValue** shadowMemToArray(UInt* n) {
+	ShadowValue** memory = VG_(malloc)("fd.shadowMemToArray.1", (shadowMemCount + 1) * sizeof(ShadowValue*));
+	UInt count = 0;
+	ShadowSecMap* sm;
+	Int i;
+	for (sm = allSecMaps; sm; sm = sm->allNext) {
+		if (sm->used == 0) {
+			continue;
+		}
+		for (i = 0; i < SM_SLOTS; i++) {
+			if (sm->slots[i]) {
+				memory[count++] = sm->slots[i];
+			}
+		}
+	}
+	tl_assert(count == shadowMemCount);
+	*n = count;
+	return memory;
+}
+
+/* Bounded shadow memory (--max-shadow-mb). If the limit is reached, shadow
+   values of the memory are dropped until the usage is below the low-water
+   mark. Inactive shadow values are dropped first as they are not needed
+   anymore. If this is not enough, active shadow values are evicted with
+   the clock algorithm: the hand sweeps over all slots and evicts the first
+   shadow value that has not been referenced since the last sweep. */
+static ShadowSecMap*	clockSecMap		= NULL;
+static UInt				clockSlot		= 0;
+
+static __inline__
+ULong shadowLimit(void) {
+	return ((ULong)clo_max_shadow_mb) * 1024 * 1024;
+}
+
+static void dropShadowMem(ShadowSecMap* sm, UInt slot) {
+	tl_assert(sm->slots[slot] && sm->used > 0);
+	shadowRegions[shadowRegion(sm->slots[slot]->key)]--;
+	freeShadowValue(sm->slots[slot]);
+	sm->slots[slot] = NULL;
+	sm->used--;
+	sm->pageUsed[slot / SM_PAGE_SLOTS]--;
+	shadowMemCount--;
+}
+
+static void countEviction(Addr origin) {
+	ShadowEviction* ev = VG_(HT_lookup)(shadowEvictions, origin);
+	if (ev == NULL) {
+		ev = VG_(malloc)("fd.countEviction.1", sizeof(ShadowEviction));
+		ev->key = origin;
+		ev->count = 0;
+		VG_(HT_add_node)(shadowEvictions, ev);
+	}
+	ev->count++;
+	shadowEvicted++;
+}
+
+static void freeEmptySecMaps(void) {
+	ShadowSecMap* prev = NULL;
+	ShadowSecMap* sm = allSecMaps;
+	while (sm) {
+		ShadowSecMap* next = sm->allNext;
+		if (sm->used > 0) {
+			prev = sm;
+			sm = next;
+			continue;
+		}
+
+		if (prev) {
+			prev->allNext = next;
+		} else {
+			allSecMaps = next;
+		}
+		if (sm->key < N_PRIMARY_MAP) {
+			primaryMap[sm->key] = NULL;
+		} else {
+			VG_(HT_remove)(auxSecMaps, sm->key);
+		}
+		if (clockSecMap == sm) {
+			clockSecMap = next;
+			clockSlot = 0;
+		}
+		VG_(free)(sm);
+		secMapCount--;
+		shadowBytes -= sizeof(ShadowSecMap);
+		sm = next;
+	}
+}
+
+static void reclaimShadowMem(void) {
+	/* 7/8 of the limit, so that the next allocations do not trigger this again */
+	ULong lowWater = shadowLimit() - (shadowLimit() >> 3);
+	ShadowSecMap* sm;
+	UInt i;
+
+	for (sm = allSecMaps; sm; sm = sm->allNext) {
+		for (i = 0; i < SM_SLOTS && sm->used > 0; i++) {
+			if (sm->slots[i] && !(sm->slots[i]->active)) {
+				dropShadowMem(sm, i);
+			}
+		}
+	}
+	freeEmptySecMaps();
+
+	if (shadowBytes > lowWater && shadowEvicted == 0) {
+		VG_(umsg)("Shadow memory limit of %ld MB reached, shadow values are evicted\n", clo_max_shadow_mb);
+	}
+
+	while (shadowBytes > lowWater && shadowMemCount > 0) {
+		if (!clockSecMap) {
+			clockSecMap = allSecMaps;
+			clockSlot = 0;
+		}
+		ShadowSecMap* current = clockSecMap;
+		if (current->used > 0) {
+			ShadowValue* sv = current->slots[clockSlot];
+			if (sv) {
+				if (sv->referenced) {
+					sv->referenced = False;
+				} else {
+					countEviction(dataCold(sv->data)->origin);
+					dropShadowMem(current, clockSlot);
+				}
+			}
+			clockSlot++;
+		} else {
+			clockSlot = SM_SLOTS;
+		}
+
+		if (clockSlot == SM_SLOTS) {
+			clockSecMap = current->allNext;
+			clockSlot = 0;
+			/* the secondary map itself counts towards the limit */
+			if (current->used == 0) {
+				freeEmptySecMaps();
+			}
+		}
+	}
+}
+
+/* Drops the shadow values in the slots first to last of sm that belong to an
+   address in [a, end). Pages without shadow values are skipped. */
+static void dropShadowSlots(ShadowSecMap* sm, UInt first, UInt last, Addr a, Addr end) {
+	UInt i = first;
+	while (i <= last && sm->used > 0) {
+		UInt page = i / SM_PAGE_SLOTS;
+		UInt pageEnd = (page + 1) * SM_PAGE_SLOTS;
+		if (sm->pageUsed[page] == 0) {
+			i = pageEnd;
+			continue;
+		}
+		for (; i < pageEnd && i <= last && sm->pageUsed[page] > 0; i++) {
+			ShadowValue* sv = sm->slots[i];
+			if (sv && sv->key >= a && sv->key < end) {
+				dropShadowMem(sm, i);
+				shadowDropped++;
+			}
+		}
+	}
+}
+
+/* Drops all shadow values of the memory in [a, a+len), e.g. when the memory is
+   freed, unmapped or written by the kernel. Secondary maps and pages without 
+   shadow values are skipped as a whole, so for the common case of a small range
+   without shadow values this is only a lookup in the primary map and a check
+   of the page counter. Large ranges are handled by iterating over the existing
+   secondary maps instead of over the address range. */
+static void dropShadowRange(Addr a, SizeT len) {
+	if (len == 0 || shadowMemCount == 0) {
+		return;
+	}
+
+	Addr end = a + len;
+	if (end < a) {
+		end = ~((Addr)0);
+	}
+	ShadowSecMap* sm;
+
+	if ((len >> SM_BITS) > secMapCount) {
+		for (sm = allSecMaps; sm; sm = sm->allNext) {
+			if (sm->used == 0) {
+				continue;
+			}
+			Addr smStart = ((Addr)sm->key) << SM_BITS;
+			if (smStart + SM_SIZE <= a || smStart >= end) {
+				continue;
+			}
+			dropShadowSlots(sm, 0, SM_SLOTS - 1, a, end);
+		}
+		freeEmptySecMaps();
+		return;
+	}
+
+	Addr cur = a;
+	while (cur < end) {
+		Addr smEnd = (cur | SM_MASK) + 1;
+		if (smEnd > end || smEnd == 0) {
+			smEnd = end;
+		}
+		sm = getSecMap(cur, False);
+		if (sm && sm->used > 0) {
+			dropShadowSlots(sm, (cur & SM_MASK) >> SM_SLOT_SHIFT, ((smEnd - 1) & SM_MASK) >> SM_SLOT_SHIFT, a, end);
+		}
+		if (smEnd == end) {
+			break;
+		}
+		cur = smEnd;
+	}
+}
+
+/* Copies the shadow values of [src, src+len) to [dst, dst+len), e.g. for memcpy
+   or realloc. Shadow values that were in the destination range are dropped. The
+   ranges may overlap, hence the copies are created before anything is dropped. */
+static void copyShadowRange(Addr src, Addr dst, SizeT len) {
+	if (len == 0 || src == dst || src + len < src) {
+		return;
+	}
+
+	XArray* copies = NULL;
+	if (shadowMemCount > 0) {
+		if (clo_max_shadow_mb > 0 && shadowBytes >= shadowLimit()) {
+			reclaimShadowMem();
+		}
+
+		Addr end = src + len;
+		Addr cur = src;
+		while (cur < end) {
+			Addr smEnd = (cur | SM_MASK) + 1;
+			if (smEnd > end || smEnd == 0) {
+				smEnd = end;
+			}
+			ShadowSecMap* sm = getSecMap(cur, False);
+			if (sm && sm->used > 0) {
+				UInt i = (cur & SM_MASK) >> SM_SLOT_SHIFT;
+				UInt last = ((smEnd - 1) & SM_MASK) >> SM_SLOT_SHIFT;
+				for (; i <= last; i++) {
+					if (sm->pageUsed[i / SM_PAGE_SLOTS] == 0) {
+						/* continue with the first slot of the next page */
+						i = (i / SM_PAGE_SLOTS + 1) * SM_PAGE_SLOTS - 1;
+						continue;
+					}
+					ShadowValue* sv = sm->slots[i];
+					if (!sv || !(sv->active) || sv->key < src || sv->key >= end) {
+						continue;
+					}
+
+					ShadowValue* copy = initShadowValue(dst + (sv->key - src));
+					copyShadowValue(copy, sv);
+					/* the original value has been copied as well */
+					svCold(copy)->orgType = svCold(sv)->orgType;
+					svCold(copy)->Org = svCold(sv)->Org;
+					if (!copies) {
+						copies = VG_(newXA)(VG_(malloc), "fd.copyShadowRange.1", VG_(free), sizeof(ShadowValue*));
+					}
+					VG_(addToXA)(copies, &copy);
+				}
+			}
+			if (smEnd == end) {
+				break;
+			}
+			cur = smEnd;
+		}
+	}
+
+	dropShadowRange(dst, len);
+
+	if (copies) {
+		Word i;
+		for (i = 0; i < VG_(sizeXA)(copies); i++) {
+			ShadowValue* copy = *(ShadowValue**)VG_(indexXA)(copies, i);
+			setShadowMem(copy->key, copy);
+		}
+		shadowCopied += VG_(sizeXA)(copies);
+		VG_(deleteXA)(copies);
+	}
+}
+
+/* Copies [src, src+len) to [dst, dst+len) for the replacements of memcpy and
+   memmove. The data is copied here and not by the client, whose word-wise
+   copy would call the helpers for each word and overwrite the shadow values
+   of overlapping ranges before copyShadowRange reads them. Returns False if
+   a range is not accessible, the client copies the data itself then. */
+static Bool copyMemory(Addr dst, Addr src, SizeT len) {
+	if (len == 0 || dst == src) {
+		return True;
+	}
+	if (!VG_(am_is_valid_for_client)(src, len, VKI_PROT_READ) ||
+			!VG_(am_is_valid_for_client)(dst, len, VKI_PROT_WRITE)) {
+		return False;
+	}
+	copyShadowRange(src, dst, len);
+	VG_(memmove)((void*)dst, (void*)src, len);
+	return True;
+}
+
+/* Adds the relative error in meanRelError to the operation at key. The
+   zero error of an exact result changes neither the sum nor the maximum. */
+static void addMeanValue(UWord key, IROp op, Bool exact, mpfr_exp_t canceled, Addr arg1, Addr arg2, UInt cancellationBadness) {
+	MeanValue* val = VG_(HT_lookup)(meanValues, key);
+	if (val == NULL) {
+		val = VG_(malloc)("fd.updateMeanValue.1", sizeof(MeanValue));
+		val->key = key;
+		val->op = op;
+		val->count = 1;
+		val->visited = False;
+		val->overflow = False;
+		mpfr_init_set(val->sum, meanRelError, STD_RND);
+		mpfr_init_set(val->max, meanRelError, STD_RND);
+		val->canceledSum = canceled;
+		val->canceledMax = canceled;
+		val->cancellationBadnessSum = cancellationBadness;
+		val->cancellationBadnessMax = cancellationBadness;
+		VG_(HT_add_node)(meanValues, val);
+		val->arg1 = arg1;
+		val->arg2 = arg2;
+	} else {
+		val->count++;
+		if (!exact) {
+			mpfr_add(val->sum, val->sum, meanRelError, STD_RND);
+		}
+
+		mpfr_exp_t oldSum = val->canceledSum;
+		val->canceledSum += canceled;
+		/* check for overflow */
+		if (oldSum > val->canceledSum) {
+			val->overflow = True;
+		}
+
+		val->cancellationBadnessSum += cancellationBadness;
+
+		if (!exact && mpfr_cmp(meanRelError, val->max) > 0) {
+			mpfr_set(val->max, meanRelError, STD_RND);
+			val->arg1 = arg1;
+			val->arg2 = arg2;
+		}
+
+		if (canceled > val->canceledMax) {
+			val->canceledMax = canceled;
+		}
+
+		if (cancellationBadness > val->cancellationBadnessMax) {
+			val->cancellationBadnessMax = cancellationBadness;
+		}
+	}
+}
+
+/* shadow is NULL for a step of a summation site that is only counted,
+   its relative error is zero */
+static void updateMeanValue(UWord key, IROp op, mpfr_t* shadow, mpfr_exp_t canceled, Addr arg1, Addr arg2, UInt cancellationBadness) {
+	if (shadow == NULL) {
+		mpfr_set_ui(meanRelError, 0, STD_RND);
+	} else if (mpfr_cmp_ui(meanOrg, 0) != 0 || mpfr_cmp_ui(*shadow, 0) != 0) {
+		mpfr_reldiff(meanRelError, *shadow, meanOrg, STD_RND);
+		mpfr_abs(meanRelError, meanRelError, STD_RND);
+	} else {
+		mpfr_set_ui(meanRelError, 0, STD_RND);
+	}
+	addMeanValue(key, op, shadow == NULL, canceled, arg1, arg2, cancellationBadness);
+}
+
+/* like updateMeanValue for a step of a summation site with --exact-sums.
+   Rounding the accumulator to MPFR takes up to 4 * ACC_WORDS operations,
+   so only every ACC_MEAN_INTERVAL-th step computes the relative error, it
+   stands in for the steps that follow. Those are only counted. */
+static void updateAccMeanValue(UWord key, IROp op, const Accumulator* acc, Bool sample, Double org, mpfr_exp_t canceled, Addr arg1, Addr arg2, UInt cancellationBadness) {
+	if (!sample) {
+		updateMeanValue(key, op, NULL, canceled, arg1, arg2, cancellationBadness);
+		return;
+	}
+	mpfr_set_d(meanOrg, org, STD_RND);
+	accToMpfr(acc, &accValue);
+	updateMeanValue(key, op, &accValue, canceled, arg1, arg2, cancellationBadness);
+
+	MeanValue* val = VG_(HT_lookup)(meanValues, key);
+	mpfr_mul_ui(meanRelError, meanRelError, ACC_MEAN_INTERVAL - 1, STD_RND);
+	mpfr_add(val->sum, val->sum, meanRelError, STD_RND);
+}
+
+/* like updateMeanValue for the parts, only the relative error is
+   converted to MPFR */
+static void updatePartsMeanValue(UWord key, IROp op, const Double* shadow, Double org, mpfr_exp_t canceled, Addr arg1, Addr arg2, UInt cancellationBadness) {
+	mpfr_set_d(meanRelError, partsRelError(shadow, org), STD_RND);
+	addMeanValue(key, op, False, canceled, arg1, arg2, cancellationBadness);
+}
+
+/* like updateMeanValue for a result computed natively, the simulated one
+   of --sim-original or an exact one. An exact result is only exact with
+   respect to the shadow values of the arguments, which need not be the
+   original values (a float temporary keeps the double shadow of F64toF32),
+   so it is compared with the original value like the simulated one. */
+static void updateNativeMeanValue(UWord key, IROp op, Double shadow, Double org, mpfr_exp_t canceled, Addr arg1, Addr arg2, UInt cancellationBadness) {
+	if (*(ULong*)&shadow == *(ULong*)&org) {
+		mpfr_set_ui(meanRelError, 0, STD_RND);
+		addMeanValue(key, op, True, canceled, arg1, arg2, cancellationBadness);
+	} else {
+		/* +0 and -0 differ only in the sign */
+		mpfr_set_d(meanRelError, shadow == org ? 0 : absDouble((shadow - org) / shadow), STD_RND);
+		addMeanValue(key, op, False, canceled, arg1, arg2, cancellationBadness);
+	}
+}
+
+/* Compares the relative error of the check lane with the one in
+   meanRelError, computed by updateMeanValue for the same original value
+   in meanOrg. The site is reported if they differ by more than
+   LANE_DIFF_LIMIT. */
+static void checkLanes(UWord key, mpfr_ptr lane) {
+	if (mpfr_cmp_ui(meanOrg, 0) != 0 || mpfr_cmp_ui(lane, 0) != 0) {
+		mpfr_reldiff(laneRelError, lane, meanOrg, STD_RND);
+		mpfr_abs(laneRelError, laneRelError, STD_RND);
+	} else {
+		mpfr_set_ui(laneRelError, 0, STD_RND);
+	}
+
+	Double err = mpfr_get_d(meanRelError, STD_RND);
+	Double checkErr = mpfr_get_d(laneRelError, STD_RND);
+	if (err == checkErr) {
+		return;
+	}
+	Double diff = absDouble(err - checkErr) / (err > checkErr ? err : checkErr);
+	if (!(diff > LANE_DIFF_LIMIT)) {
+		return;
+	}
+
+	LaneSite* ls = VG_(HT_lookup)(laneSites, key);
+	if (ls == NULL) {
+		ls = VG_(malloc)("fd.checkLanes.1", sizeof(LaneSite));
+		ls->key = key;
+		ls->count = 0;
+		ls->maxDiff = 0;
+		mpfr_inits(ls->err, ls->checkErr, NULL);
+		VG_(HT_add_node)(laneSites, ls);
+	}
+	ls->count++;
+	if (diff > ls->maxDiff) {
+		ls->maxDiff = diff;
+		mpfr_set(ls->err, meanRelError, STD_RND);
+		mpfr_set(ls->checkErr, laneRelError, STD_RND);
+	}
+}
+
+static void stageClearVals(VgHashTable t) {
+	if (t == NULL) {
+		return;
+	}
+
+	VG_(HT_ResetIter)(t);
+	StageValue* next;
+	while (next = VG_(HT_Next)(t)) {
+		mpfr_clears(next->val, next->relError, NULL);
+	}
+	VG_(HT_destruct)(t);
+}
+
+static void stageStart(Int num) {
+	tl_assert(num < MAX_STAGES);
+	
+	if (stages[num]) {
+		tl_assert(!stages[num]->active);
+		stages[num]->active = True;
+		stages[num]->count++;
+	} else {
+		stages[num] = VG_(malloc)("fd.stageStart.1", sizeof(Stage));
+		stages[num]->active = True;
+		stages[num]->count = 1;
+		stages[num]->oldVals = NULL;
+		stages[num]->limits = VG_(HT_construct)("Stage limits");
+	}
+	stages[num]->newVals = VG_(HT_construct)("Stage values");
+	activeStages++;
+}
+
+static void stageEnd(Int num) {
+	tl_assert(stages[num]);
+	tl_assert(stages[num]->active);
+
+	Int mateCount = -1;
+	Int newNodes = 0;
+	Int oldNodes = 0;
+
+	if (stages[num]->newVals && stages[num]->oldVals) {
+		mateCount = 0;
+
+		VG_(HT_ResetIter)(stages[num]->newVals);
+		StageValue* next;
+		StageValue* mate;
+
+		while (next = VG_(HT_Next)(stages[num]->newVals)) {
+			mate = VG_(HT_lookup)(stages[num]->oldVals, next->key);
+			if (!mate) {
+				VG_(dmsg)("no mate: %d\n", num);
+				continue;
+			}
+
+			mateCount++;
+			StageLimit* sl = VG_(HT_lookup)(stages[num]->limits, next->key);
+
+			mpfr_sub(stageDiff, mate->relError, next->relError, STD_RND);
+			mpfr_abs(stageDiff, stageDiff, STD_RND);
+
+			Char mpfrBuf[MPFR_BUFSIZE];
+			if (sl) {
+				if (mpfr_cmp(stageDiff, sl->limit) > 0) {
+					mpfrToString(mpfrBuf, &(sl->limit));
+					mpfrToString(mpfrBuf, &(stageDiff));
+
+					/* adjust limit for the following iterations */
+					mpfr_set(sl->limit, stageDiff, STD_RND);
+
+					/* create stage report */
+					StageReport* report = NULL;
+					if (stageReports[num]) {
+						report = VG_(HT_lookup)(stageReports[num], next->key);
+					} else {
+						stageReports[num] = VG_(HT_construct)("Stage reports");
+					}
+					if (report) {
+						report->count++;
+						report->iterMax = stages[num]->count;
+					} else {
+						report = VG_(malloc)("fd.stageEnd.1", sizeof(StageReport));
+						report->key = next->key;
+						report->count = 1;
+						report->iterMin = stages[num]->count;
+						report->iterMax = stages[num]->count;
+						report->origin = 0;
+						ShadowValue* sv = getShadowMem(next->key);
+						if (sv) {
+							report->origin = dataCold(sv->data)->origin;
 						}
 						VG_(HT_add_node)(stageReports[num], report);
 					}
@@ -551,305 +1840,1070 @@ static void stageEnd(Int num) {
 		}
 	}
 
-	stages[num]->active = False;
-	stageClearVals(stages[num]->oldVals);
-	stages[num]->oldVals = stages[num]->newVals;
-	stages[num]->newVals = NULL;
-	activeStages--;
+	stages[num]->active = False;
+	stageClearVals(stages[num]->oldVals);
+	stages[num]->oldVals = stages[num]->newVals;
+	stages[num]->newVals = NULL;
+	activeStages--;
+}
+
+static void updateStages(Addr addr, Bool isFloat) {
+	if (isFloat) {
+		Float f = *(Float*)addr;
+		mpfr_set_flt(stageOrg, f, STD_RND);
+	} else {
+		Double d = *(Double*)addr;
+		mpfr_set_d(stageOrg, d, STD_RND);
+	}
+	ShadowValue* svalue = getShadowMem(addr);
+
+	if (svalue && svalue->active) {
+		materialize(svalue->data);
+		mpfr_sub(stageDiff, svalue->data->value, stageOrg, STD_RND);
+
+		if (mpfr_cmp_ui(svalue->data->value, 0) != 0 || mpfr_cmp_ui(stageOrg, 0) != 0) {
+			mpfr_reldiff(stageRelError, svalue->data->value, stageOrg, STD_RND);
+			mpfr_abs(stageRelError, stageRelError, STD_RND);
+		} else {
+			mpfr_set_ui(stageRelError, 0, STD_RND);
+		}
+
+		Int i;
+		for (i = 0; i < MAX_STAGES; i++) {
+			if (!stages[i] || !(stages[i]->active) || !(stages[i]->newVals)) {
+				continue;
+			}
+
+			StageValue* sv = VG_(HT_lookup)(stages[i]->newVals, addr);
+			if (sv) {
+				if (mpfr_cmpabs(stageRelError, sv->relError) > 0) {
+					mpfr_set(sv->val, svalue->data->value, STD_RND);
+					mpfr_set(sv->relError, stageRelError, STD_RND);
+				}
+			} else {
+				sv = VG_(malloc)("fd.updateStages.1", sizeof(StageValue));
+				sv->key = addr;
+				mpfr_init_set(sv->val, svalue->data->value, STD_RND);
+				mpfr_init_set(sv->relError, stageRelError, STD_RND);
+				VG_(HT_add_node)(stages[i]->newVals, sv);
+			}
+		}
+	}
+}
+
+static void stageClear(Int num) {
+	if (stages[num] == NULL) {
+		return;
+	}
+	stageClearVals(stages[num]->oldVals);
+	stageClearVals(stages[num]->newVals);
+	if (stages[num]->limits != NULL) {
+		VG_(HT_ResetIter)(stages[num]->limits);
+		StageLimit* next;
+		while ( (next = VG_(HT_Next)(stages[num]->limits)) ) {
+			mpfr_clear(next->limit);
+		}
+		VG_(HT_destruct)(stages[num]->limits);
+	}
+	stages[num] = NULL;
+}
+
+static __inline__
+void readSConst(Int num, mpfr_t* fp) {
+	Int i;
+	ULong v128 = 0;
+	Double* db;
+
+	switch (sConst[num]->tag) {
+		case Ico_F64:
+			mpfr_set_d(*fp, (Double)sConst[num]->Val.F64, STD_RND);
+			break;
+		case Ico_V128:
+			/* 128-bit restricted vector constant with 1 bit (repeated 8 times)
+			   for each of the 16 1-byte lanes */
+			for (i = 7; i >= 0; i--) {
+				if ((sConst[num]->Val.V128 >> (i + 8)) & 1) {
+					v128 &= 0xFF;
+				}
+				v128 <<= 8;
+			}
+			db = &v128;
+			mpfr_set_d(*fp, *db, STD_RND);
+			break;
+		default:		
+			VG_(tool_panic)("Unhandled case in readSConst\n");
+			break;
+	}
+}
+
+/* The operations that get shadow values, as _(op, isFloat). isOpFloat,
+   isShadowedOp and the switches of fd_instrument are all generated from
+   these lists. SPECIALIZED_BINOPS is the subset with its own copy of
+   processBinOp. */
+#define SHADOWED_UNOPS(_) \
+	_(Sqrt32F0x4,	True) \
+	_(Sqrt64F0x2,	False) \
+	_(NegF32,		True) \
+	_(NegF64,		False) \
+	_(AbsF32,		True) \
+	_(AbsF64,		False)
+
+#define SHADOWED_BINOPS(_) \
+	_(Add32F0x4,	True) \
+	_(Sub32F0x4,	True) \
+	_(Mul32F0x4,	True) \
+	_(Div32F0x4,	True) \
+	_(Min32F0x4,	True) \
+	_(Max32F0x4,	True) \
+	_(Add64F0x2,	False) \
+	_(Sub64F0x2,	False) \
+	_(Mul64F0x2,	False) \
+	_(Div64F0x2,	False) \
+	_(Min64F0x2,	False) \
+	_(Max64F0x2,	False)
+
+/* arg1 is the rounding mode */
+#define SHADOWED_TRIOPS(_) \
+	_(AddF64,		False) \
+	_(SubF64,		False) \
+	_(MulF64,		False) \
+	_(DivF64,		False)
+
+/* Conversions that only move a shadowed value, the result shares the
+   shadow value of the argument, see tmpInstead in fd_instrument. */
+#define MOVED_UNOPS(_) \
+	_(F32toF64) \
+	_(ReinterpI64asF64) \
+	_(32UtoV128) \
+	_(V128to64) \
+	_(V128HIto64) \
+	_(64to32) \
+	_(64HIto32) \
+	_(64UtoV128) \
+	_(32Uto64)
+
+#define MOVED_BINOPS(_) \
+	_(F64toF32) \
+	_(64HLtoV128) \
+	_(32HLto64)
+
+#define SHADOWED_CASE(_op, _float)	case Iop_##_op:
+#define MOVED_CASE(_op)				case Iop_##_op:
+#define IS_FLOAT_CASE(_op, _float)	case Iop_##_op: return _float;
+
+static __inline__
+Bool isOpFloat(IROp op) {
+	switch (op) {
+		SHADOWED_UNOPS(IS_FLOAT_CASE)
+		SHADOWED_BINOPS(IS_FLOAT_CASE)
+		SHADOWED_TRIOPS(IS_FLOAT_CASE)
+		default:
+			// TODO warn
+			//VG_(tool_panic)("Unhandled operation in isOpFloat\n");
+			return False;
+	}
+}
+
+static __inline__
+IRTemp assignNew(IRSB* sb, IRType type, IRExpr* e) {
+	IRTemp t = newIRTemp(sb->tyenv, type);
+	addStmtToIRSB(sb, IRStmt_WrTmp(t, e));
+	return t;
+}
+
+/* Inline tests for the guards of the dirty calls, so that the helpers that
+   would return at once are not called. They may pass when there is nothing
+   to do, but never fail when there is. */
+
+/* the memory at addr may have a shadow value, see shadowRegions */
+static IRTemp shadowMemGuard(IRSB* sb, IRExpr* addr) {
+	IRTemp page = assignNew(sb, Ity_I64, IRExpr_Binop(Iop_Shr64, addr, mkU8(SM_PAGE_BITS)));
+	IRTemp region = assignNew(sb, Ity_I64, IRExpr_Binop(Iop_And64, IRExpr_RdTmp(page), mkU64(SHADOW_REGIONS - 1)));
+	IRTemp offset = assignNew(sb, Ity_I64, IRExpr_Binop(Iop_Shl64, IRExpr_RdTmp(region), mkU8(2)));
+	IRTemp counter = assignNew(sb, Ity_I64, IRExpr_Binop(Iop_Add64, IRExpr_RdTmp(offset), mkU64((Addr)shadowRegions)));
+	IRTemp count = assignNew(sb, Ity_I32, IRExpr_Load(Iend_LE, Ity_I32, IRExpr_RdTmp(counter)));
+	return assignNew(sb, Ity_I1, IRExpr_Binop(Iop_CmpNE32, IRExpr_RdTmp(count), mkU32(0)));
+}
+
+/* the temporary has a shadow value in this execution of the block, see getTemp */
+static IRTemp tempGuard(IRSB* sb, IRTemp tmp) {
+	tl_assert(tmp >= 0 && tmp < MAX_TEMPS);
+	IRTemp version = assignNew(sb, Ity_I64, IRExpr_Load(Iend_LE, Ity_I64, mkU64((Addr)&(tempShadowed[tmp]))));
+	IRTemp current = assignNew(sb, Ity_I64, IRExpr_Load(Iend_LE, Ity_I64, mkU64((Addr)&sbExecuted)));
+	return assignNew(sb, Ity_I1, IRExpr_Binop(Iop_CmpEQ64, IRExpr_RdTmp(version), IRExpr_RdTmp(current)));
+}
+
+static IRTemp orGuards(IRSB* sb, IRTemp g1, IRTemp g2) {
+	IRTemp w1 = assignNew(sb, Ity_I32, IRExpr_Unop(Iop_1Uto32, IRExpr_RdTmp(g1)));
+	IRTemp w2 = assignNew(sb, Ity_I32, IRExpr_Unop(Iop_1Uto32, IRExpr_RdTmp(g2)));
+	IRTemp w = assignNew(sb, Ity_I32, IRExpr_Binop(Iop_Or32, IRExpr_RdTmp(w1), IRExpr_RdTmp(w2)));
+	return assignNew(sb, Ity_I1, IRExpr_Binop(Iop_CmpNE32, IRExpr_RdTmp(w), mkU32(0)));
+}
+
+/* The native value of an argument as a 64-bit integer for a dirty call,
+   vectors only pass their lowest 64 bits. The helpers do not read the
+   value of constants and of other types, they get zero. */
+static IRExpr* tempBits(IRSB* sb, IRTypeEnv* env, IRExpr* e) {
+	IRTemp t;
+	if (e->tag != Iex_RdTmp) {
+		return mkU64(0);
+	}
+	switch (typeOfIRTemp(env, e->Iex.RdTmp.tmp)) {
+		case Ity_I8:
+			t = assignNew(sb, Ity_I64, IRExpr_Unop(Iop_8Uto64, e));
+			break;
+		case Ity_I16:
+			t = assignNew(sb, Ity_I64, IRExpr_Unop(Iop_16Uto64, e));
+			break;
+		case Ity_I32:
+			t = assignNew(sb, Ity_I64, IRExpr_Unop(Iop_32Uto64, e));
+			break;
+		case Ity_I64:
+			return e;
+		case Ity_F32:
+			t = assignNew(sb, Ity_I32, IRExpr_Unop(Iop_ReinterpF32asI32, e));
+			t = assignNew(sb, Ity_I64, IRExpr_Unop(Iop_32Uto64, IRExpr_RdTmp(t)));
+			break;
+		case Ity_F64:
+			t = assignNew(sb, Ity_I64, IRExpr_Unop(Iop_ReinterpF64asI64, e));
+			break;
+		case Ity_V128:
+			t = assignNew(sb, Ity_I64, IRExpr_Unop(Iop_V128to64, e));
+			break;
+		default:
+			return mkU64(0);
+	}
+	return IRExpr_RdTmp(t);
+}
+
+static void initOpDesc(OpDesc* desc, Addr addr, IROp op, IRTemp wrTemp) {
+	VG_(memset)(desc, 0, sizeof(OpDesc));
+	desc->key = addr;
+	desc->op = op;
+	desc->wrTmp = wrTemp;
+	desc->prec = sitePrecision(addr, isOpFloat(op));
+}
+
+/* Adds the argument with index num, tmpInstead is the temporary of its
+   shadow value if it is not the one read by the operation. */
+static void setDescArg(OpDesc* desc, IRTypeEnv* env, IRExpr* arg, Int num, Int tmpInstead) {
+	tl_assert(num < TMP_COUNT && num < CONST_COUNT);
+	if (arg->tag == Iex_RdTmp) {
+		IRType type = typeOfIRTemp(env, arg->Iex.RdTmp.tmp);
+		if (type != Ity_F32 && type != Ity_F64 && type != Ity_V128) {
+			VG_(tool_panic)("Unhandled case in setDescArg\n");
+		}
+		desc->arg[num] = tmpInstead >= 0 ? tmpInstead : arg->Iex.RdTmp.tmp;
+		desc->argType[num] = type;
+		return;
+	}
+
+	tl_assert(arg->tag == Iex_Const);
+	IRConst* c = arg->Iex.Const.con;
+	desc->consts[num].tag = c->tag;
+	switch (c->tag) {
+		case Ico_F64:
+			desc->consts[num].Val.F64 = c->Ico.F64;
+			break;
+		case Ico_V128:
+			desc->consts[num].Val.V128 = c->Ico.V128;
+			break;
+		default:
+			VG_(tool_panic)("Unhandled case in setDescArg\n");
+			break;
+	}
+	desc->constArgs |= 1 << num;
+}
+
+/* Returns the shared copy of desc. Retranslations of an operation
+   usually have the same temporaries and find the one built before. */
+static OpDesc* internOpDesc(OpDesc* desc) {
+	SizeT offset = (Char*)&(desc->op) - (Char*)desc;
+	OpDesc* first = VG_(HT_lookup)(opDescs, desc->key);
+	OpDesc* d;
+
+	for (d = first; d; d = d->alt) {
+		if (VG_(memcmp)((Char*)d + offset, (Char*)desc + offset, sizeof(OpDesc) - offset) == 0) {
+			return d;
+		}
+	}
+	d = VG_(malloc)("fd.internOpDesc.1", sizeof(OpDesc));
+	VG_(memcpy)(d, desc, sizeof(OpDesc));
+	if (first) {
+		d->alt = first->alt;
+		first->alt = d;
+	} else {
+		d->alt = NULL;
+		VG_(HT_add_node)(opDescs, d);
+	}
+	return d;
 }
 
-static void updateStages(Addr addr, Bool isFloat) {
-	if (isFloat) {
-		Float f = *(Float*)addr;
-		mpfr_set_flt(stageOrg, f, STD_RND);
+/* Makes the argument with index num readable by readSTemp and readSConst. */
+static __inline__
+void setArgBits(OpDesc* desc, Int constArgs, Int num, ULong bits) {
+	if (constArgs & (1 << num)) {
+		sConst[num] = &(desc->consts[num]);
 	} else {
-		Double d = *(Double*)addr;
-		mpfr_set_d(stageOrg, d, STD_RND);
+		sTmp[num].type = desc->argType[num];
+		sTmp[num].bits = bits;
 	}
-	ShadowValue* svalue = VG_(HT_lookup)(globalMemory, addr);
+}
 
-	if (svalue && svalue->active) {
-		mpfr_sub(stageDiff, svalue->value, stageOrg, STD_RND);
+/* the original result, floats are widened */
+static __inline__
+Double orgValue(IROp op, ULong bits) {
+	if (isOpFloat(op)) {
+		UInt lo = (UInt)bits;
+		return *(Float*)&lo;
+	}
+	return *(Double*)&bits;
+}
 
-		if (mpfr_cmp_ui(svalue->value, 0) != 0 || mpfr_cmp_ui(stageOrg, 0) != 0) {
-			mpfr_reldiff(stageRelError, svalue->value, stageOrg, STD_RND);
-			mpfr_abs(stageRelError, stageRelError, STD_RND);
-		} else {
-			mpfr_set_ui(stageRelError, 0, STD_RND);
-		}
+/* Shadow values that are exactly equal to the original value do not need
+   MPFR. Their native value is kept instead and the error-free
+   transformations TwoSum and TwoProduct show whether the result of an
+   operation is still exact. The range check keeps the splitting of
+   TwoProduct and its error term away from overflow and underflow
+   (see fd_qd.c for the transformations). They need a*b - p to be
+   computed with two roundings, -ffp-contract=off in Makefile.am keeps
+   GCC from contracting it to an FMA. */
+#define EXACT_MIN_EXP		(1023 - 460)
+#define EXACT_MAX_EXP		(1023 + 460)
 
-		Int i;
-		for (i = 0; i < MAX_STAGES; i++) {
-			if (!stages[i] || !(stages[i]->active) || !(stages[i]->newVals)) {
-				continue;
+static __inline__
+Bool isExactRange(Double x) {
+	ULong bits = *(ULong*)&x;
+	UInt e = (UInt)((bits >> 52) & 0x7FF);
+	return (bits << 1) == 0 || (e >= EXACT_MIN_EXP && e <= EXACT_MAX_EXP);
+}
+
+/* Computes the result of a binary operation natively if it is exact.
+   For float operations the result is computed with doubles and has to
+   be representable as a float. */
+static Bool exactBinOp(IROp op, Bool isFloat, Double a, Double b, Double* res) {
+	if (!isExactRange(a) || !isExactRange(b)) {
+		return False;
+	}
+
+	Double err;
+	switch (op) {
+		case Iop_Add32F0x4:
+		case Iop_Add64F0x2:
+		case Iop_AddF64:
+			*res = a + b;
+			err = twoSumErr(a, b, *res);
+			break;
+		case Iop_Sub32F0x4:
+		case Iop_Sub64F0x2:
+		case Iop_SubF64:
+			*res = a - b;
+			err = twoSumErr(a, -b, *res);
+			break;
+		case Iop_Mul32F0x4:
+		case Iop_Mul64F0x2:
+		case Iop_MulF64:
+			*res = a * b;
+			err = twoProdErr(a, b, *res);
+			break;
+		case Iop_Div32F0x4:
+		case Iop_Div64F0x2:
+		case Iop_DivF64:
+			if (b == 0) {
+				return False;
+			}
+			*res = a / b;
+			if (*res * b != a) {
+				return False;
+			}
+			err = twoProdErr(*res, b, a);
+			break;
+		case Iop_Min32F0x4:
+		case Iop_Min64F0x2:
+		case Iop_Max32F0x4:
+		case Iop_Max64F0x2:
+			/* the sign of the result of min(0, -0) is left to MPFR */
+			if (a == b) {
+				return False;
+			}
+			if (op == Iop_Min32F0x4 || op == Iop_Min64F0x2) {
+				*res = a < b ? a : b;
+			} else {
+				*res = a > b ? a : b;
 			}
+			err = 0;
+			break;
+		default:
+			return False;
+	}
 
-			StageValue* sv = VG_(HT_lookup)(stages[i]->newVals, addr);
-			if (sv) {
-				if (mpfr_cmpabs(stageRelError, sv->relError) > 0) {
-					mpfr_set(sv->val, svalue->value, STD_RND);
-					mpfr_set(sv->relError, stageRelError, STD_RND);
-				}
+	if (err != 0 || !isExactRange(*res)) {
+		return False;
+	}
+	return !isFloat || (Double)(Float)*res == *res;
+}
+
+/* like getCanceledBits for an exact addition or subtraction */
+static __inline__
+mpfr_exp_t getNativeCanceledBits(Double res, Double arg1, Double arg2) {
+	if (!isRegularDouble(res) || !isRegularDouble(arg1) || !isRegularDouble(arg2)) {
+		return 0;
+	}
+	mpfr_exp_t max = maxExp(nativeExp(arg1), nativeExp(arg2));
+	mpfr_exp_t resExp = nativeExp(res);
+	return resExp < max ? max - resExp : 0;
+}
+
+/* With --sim-original the shadow values are computed with the precision
+   of the original values, which is just native float or double arithmetic.
+   The results are kept as native values like exact ones. For float
+   operations the result is computed with doubles and rounded to float,
+   which is correctly rounded for these operations. */
+static Double simulateUnOp(IROp op, Bool isFloat, Double a) {
+	Double res;
+	switch (op) {
+		case Iop_Sqrt32F0x4:
+		case Iop_Sqrt64F0x2:
+			res = sqrtDouble(a);
+			break;
+		case Iop_NegF32:
+		case Iop_NegF64:
+			res = -a;
+			break;
+		case Iop_AbsF32:
+		case Iop_AbsF64:
+			res = absDouble(a);
+			break;
+		default:
+			VG_(tool_panic)("Unhandled case in simulateUnOp\n");
+			return 0;
+	}
+	return isFloat ? (Double)(Float)res : res;
+}
+
+static Double simulateBinOp(IROp op, Bool isFloat, Double a, Double b) {
+	Double res;
+	switch (op) {
+		case Iop_Add32F0x4:
+		case Iop_Add64F0x2:
+		case Iop_AddF64:
+			res = a + b;
+			break;
+		case Iop_Sub32F0x4:
+		case Iop_Sub64F0x2:
+		case Iop_SubF64:
+			res = a - b;
+			break;
+		case Iop_Mul32F0x4:
+		case Iop_Mul64F0x2:
+		case Iop_MulF64:
+			res = a * b;
+			break;
+		case Iop_Div32F0x4:
+		case Iop_Div64F0x2:
+		case Iop_DivF64:
+			res = a / b;
+			break;
+		case Iop_Min32F0x4:
+		case Iop_Min64F0x2:
+			res = minMaxIsFirstDouble(a, b, False) ? a : b;
+			break;
+		case Iop_Max32F0x4:
+		case Iop_Max64F0x2:
+			res = minMaxIsFirstDouble(a, b, True) ? a : b;
+			break;
+		default:
+			VG_(tool_panic)("Unhandled case in simulateBinOp\n");
+			return 0;
+	}
+	return isFloat ? (Double)(Float)res : res;
+}
+
+/* like getCanceledBits for the parts */
+static __inline__
+mpfr_exp_t getPartsCanceledBits(const Double* res, const Double* arg1, const Double* arg2) {
+	mpfr_exp_t resExp, arg1Exp, arg2Exp;
+	if (!partsExp(res, &resExp) || !partsExp(arg1, &arg1Exp) || !partsExp(arg2, &arg2Exp)) {
+		return 0;
+	}
+	mpfr_exp_t max = maxExp(arg1Exp, arg2Exp);
+	return resExp < max ? max - resExp : 0;
+}
+
+/* The native value of the temporary argument with index num. Of a vector
+   the lowest float or double is taken, it is a float if the upper half
+   of the lowest 64 bits is zero. This does not work for vectors of
+   several values, e.g. two or four additions with one SSE instruction. */
+static Bool readNativeTemp(Int num, Double* x) {
+	ULong bits = sTmp[num].bits;
+	UInt lo = (UInt)bits;
+	switch (sTmp[num].type) {
+		case Ity_F32:
+			*x = *(Float*)&lo;
+			return True;
+		case Ity_F64:
+			*x = *(Double*)&bits;
+			return True;
+		case Ity_V128:
+			if ((bits >> 32) == 0) {
+				*x = *(Float*)&lo;
 			} else {
-				sv = VG_(malloc)("fd.updateStages.1", sizeof(StageValue));
-				sv->key = addr;
-				mpfr_init_set(sv->val, svalue->value, STD_RND);
-				mpfr_init_set(sv->relError, stageRelError, STD_RND);
-				VG_(HT_add_node)(stages[i]->newVals, sv);
+				*x = *(Double*)&bits;
 			}
-		}
+			return True;
+		default:
+			return False;
 	}
 }
 
-static void stageClear(Int num) {
-	if (stages[num] == NULL) {
-		return;
+static __inline__
+void readSTemp(Int num, mpfr_t* fp) {
+	Double x;
+	if (!readNativeTemp(num, &x)) {
+		VG_(tool_panic)("Unhandled case in readSTemp\n");
 	}
-	stageClearVals(stages[num]->oldVals);
-	stageClearVals(stages[num]->newVals);
-	if (stages[num]->limits != NULL) {
-		VG_(HT_ResetIter)(stages[num]->limits);
-		StageLimit* next;
-		while ( (next = VG_(HT_Next)(stages[num]->limits)) ) {
-			mpfr_clear(next->limit);
+	mpfr_set_d(*fp, x, STD_RND);
+}
+
+/* Reads the native value of an argument, if it is known to be exact.
+   Arguments without a shadow value are exact by definition. */
+static Bool readExactArg(Int num, Bool isConst, ShadowValue* sv, Double* x) {
+	if (isConst) {
+		if (sConst[num]->tag != Ico_F64) {
+			return False;
 		}
-		VG_(HT_destruct)(stages[num]->limits);
+		*x = sConst[num]->Val.F64;
+		return True;
 	}
-	stages[num] = NULL;
+	if (sv) {
+		if (sv->data->repr != Sr_EXACT) {
+			return False;
+		}
+		*x = sv->data->native;
+		return True;
+	}
+	return readNativeTemp(num, x);
 }
 
-static void writeSConst(IRSB* sb, IRConst* c, Int num) {
-	IRConstTag tag = c->tag;
+static __inline__
+void readShadowArg(Int num, Bool isConst, ShadowValue* sv, mpfr_t* fp) {
+	if (isConst) {
+		readSConst(num, fp);
+	} else if (sv == NULL) {
+		readSTemp(num, fp);
+	} else if (sv->data->repr == Sr_EXACT) {
+		mpfr_set_d(*fp, sv->data->native, STD_RND);
+	} else {
+		materialize(sv->data);
+		mpfr_set(*fp, sv->data->value, STD_RND);
+	}
+}
 
-	IRExpr* addr = NULL;
-	switch (tag) {
-		case Ico_F64:
-			addr = mkU64(&(sConst[num]->Val.F64));
+/* like readShadowArg for the check lane, all shadow data that is not
+   exact is in MPFR then */
+static __inline__
+void readLaneArg(Int num, Bool isConst, ShadowValue* sv, mpfr_t* fp) {
+	if (isConst) {
+		readSConst(num, fp);
+	} else if (sv == NULL) {
+		readSTemp(num, fp);
+	} else if (sv->data->repr == Sr_EXACT) {
+		mpfr_set_d(*fp, sv->data->native, STD_RND);
+	} else {
+		mpfr_set(*fp, checkLane(sv->data), STD_RND);
+	}
+}
+
+/* Computes the check lane of a result, b is NULL for unary operations. */
+static void computeLane(IROp op, mpfr_ptr r, mpfr_t* a, mpfr_t* b) {
+	switch (op) {
+		case Iop_Sqrt32F0x4:
+		case Iop_Sqrt64F0x2:
+			mpfr_sqrt(r, *a, STD_RND);
 			break;
-		case Ico_V128:
-			addr = mkU64(&(sConst[num]->Val.V128));
+		case Iop_NegF32:
+		case Iop_NegF64:
+			mpfr_neg(r, *a, STD_RND);
+			break;
+		case Iop_AbsF32:
+		case Iop_AbsF64:
+			mpfr_abs(r, *a, STD_RND);
+			break;
+		case Iop_Add32F0x4:
+		case Iop_Add64F0x2:
+		case Iop_AddF64:
+			mpfr_add(r, *a, *b, STD_RND);
+			break;
+		case Iop_Sub32F0x4:
+		case Iop_Sub64F0x2:
+		case Iop_SubF64:
+			mpfr_sub(r, *a, *b, STD_RND);
+			break;
+		case Iop_Mul32F0x4:
+		case Iop_Mul64F0x2:
+		case Iop_MulF64:
+			mpfr_mul(r, *a, *b, STD_RND);
+			break;
+		case Iop_Div32F0x4:
+		case Iop_Div64F0x2:
+		case Iop_DivF64:
+			mpfr_div(r, *a, *b, STD_RND);
+			break;
+		case Iop_Min32F0x4:
+		case Iop_Min64F0x2:
+			mpfr_min(r, *a, *b, STD_RND);
+			break;
+		case Iop_Max32F0x4:
+		case Iop_Max64F0x2:
+			mpfr_max(r, *a, *b, STD_RND);
 			break;
 		default:
+			VG_(tool_panic)("Unhandled case in computeLane\n");
 			break;
 	}
+}
 
-	if (addr) {
-		IRStmt* store = IRStmt_Store(Iend_LE, mkU64(&(sConst[num]->tag)), mkU32(tag));
-		addStmtToIRSB(sb, store);
-
-		IRExpr* expr_const = IRExpr_Const(c);
-		store = IRStmt_Store(Iend_LE, addr, expr_const);
-		addStmtToIRSB(sb, store);
+/* Reads an argument as parts. Only shadow values in MPFR and constants
+   that are not doubles go through fp. */
+static void readPartsArg(Int num, Bool isConst, ShadowValue* sv, mpfr_t* fp, Double* x) {
+	Double native;
+	Int i;
+	if (sv && sv->data->repr == Sr_PARTS) {
+		for (i = 0; i < shadowParts; i++) {
+			x[i] = dataParts(sv->data)[i];
+		}
+	} else if (readExactArg(num, isConst, sv, &native)) {
+		partsSetDouble(native, x);
 	} else {
-		VG_(tool_panic)("Unhandled case in writeSConst\n");
+		readShadowArg(num, isConst, sv, fp);
+		mpfrToParts(fp, x);
+	}
+}
+
+/* Reads an argument with the precision of the operation for --sim-original.
+   Only constants that are not doubles and shadow values inserted by the
+   client go through fp. */
+static void readSimulatedArg(Int num, Bool isConst, ShadowValue* sv, Bool isFloat, mpfr_t* fp, Double* x) {
+	if (!readExactArg(num, isConst, sv, x)) {
+		readShadowArg(num, isConst, sv, fp);
+		*x = mpfr_get_d(*fp, STD_RND);
+	}
+	if (isFloat) {
+		*x = (Float)*x;
 	}
 }
 
 static __inline__
-void readSConst(Int num, mpfr_t* fp) {
-	Int i;
-	ULong v128 = 0;
-	Double* db;
+Int limitExactBits(ShadowValue* sv, Int exactBits) {
+	if (svCold(sv)->orgType == Ot_FLOAT && exactBits > 23) {
+		return 23;
+	} else if (svCold(sv)->orgType == Ot_DOUBLE && exactBits > 52) {
+		return 52;
+	}
+	return exactBits;
+}
 
-	switch (sConst[num]->tag) {
-		case Ico_F64:
-			mpfr_set_d(*fp, (Double)sConst[num]->Val.F64, STD_RND);
-			break;
-		case Ico_V128:
-			/* 128-bit restricted vector constant with 1 bit (repeated 8 times)
-			   for each of the 16 1-byte lanes */
-			for (i = 7; i >= 0; i--) {
-				if ((sConst[num]->Val.V128 >> (i + 8)) & 1) {
-					v128 &= 0xFF;
-				}
-				v128 <<= 8;
+/* Fast path of getExactBits with integers only. The top 64 bits of the
+   mantissa of the shadow value are subtracted from the mantissa of the
+   original value, the leading zeros of the difference are the correct
+   bits. The lower limbs are only looked at if the top bits are equal or
+   if they may lower the exponent of a power of two difference. Returns
+   False if MPFR is needed, for special values or different signs. */
+static Bool getIntExactBits(Double org, ShadowValue* sv, mpfr_t* fp, Int* exactBits) {
+	ULong orgBits = *(ULong*)&org;
+	mp_limb_t* limbs = (*fp)->_mpfr_d;
+	/* index of the top limb */
+	Int n = (Int)(((*fp)->_mpfr_prec - 1) / GMP_NUMB_BITS);
+	ULong top, orgTop, diff;
+	Int low, i;
+
+	if (!isRegularDouble(org) || mpfr_regular_p(*fp) == 0 || (mpfr_signbit(*fp) != 0) != (Bool)(orgBits >> 63)) {
+		return False;
+	}
+	if (mpfr_get_exp(*fp) != nativeExp(org)) {
+		*exactBits = 0;
+		return True;
+	}
+#if GMP_NUMB_BITS == 64
+	top = limbs[n];
+	low = n - 1;
+#else
+	top = ((ULong)limbs[n] << 32) | limbs[n - 1];
+	low = n - 2;
+#endif
+	orgTop = ((orgBits & 0xFFFFFFFFFFFFFULL) | (1ULL << 52)) << 11;
+	diff = top > orgTop ? top - orgTop : orgTop - top;
+	if (diff == 0 || (top < orgTop && (diff & (diff - 1)) == 0)) {
+		for (i = low; i >= 0; i--) {
+			if (limbs[i] != 0) {
+				return False;
 			}
-			db = &v128;
-			mpfr_set_d(*fp, *db, STD_RND);
-			break;
-		default:		
-			VG_(tool_panic)("Unhandled case in readSConst\n");
-			break;
+		}
+		if (diff == 0) {
+			return True;
+		}
+	}
+	*exactBits = limitExactBits(sv, leadingZeros(diff) - 2);
+	return True;
+}
+
+/* Number of bits of the original value that are still correct, used to
+   tell bad cancellations from benign ones. */
+static Int getExactBits(Int num, ShadowValue* sv, mpfr_t* fp, Int exactBits) {
+	Double org;
+	if (readNativeTemp(num, &org) && getIntExactBits(org, sv, fp, &exactBits)) {
+		return exactBits;
+	}
+	readSTemp(num, &cancelTemp);
+	if (mpfr_get_exp(cancelTemp) != mpfr_get_exp(*fp)) {
+		return 0;
+	}
+	mpfr_sub(cancelTemp, *fp, cancelTemp, STD_RND);
+	if (mpfr_cmp_ui(cancelTemp, 0) != 0) {
+		exactBits = limitExactBits(sv, abs(mpfr_get_exp(*fp) - mpfr_get_exp(cancelTemp)) - 2);
 	}
+	return exactBits;
 }
 
-static void writeSTemp(IRSB* sb, IRTypeEnv* env, IRTemp tmp, Int num) {
-	IRType type = typeOfIRTemp(env, tmp);
-	IRExpr* addr = NULL;
-	switch (type) {
-		case Ity_F32:
-			addr = mkU64(&(sTmp[num]->Val.F32));
-			break;
-		case Ity_F64:
-			addr = mkU64(&(sTmp[num]->Val.F64));
-			break;
-		case Ity_V128:
-			addr = mkU64(sTmp[num]->U128);
-			break;
-		default:
-			break;
+/* like getExactBits for the parts */
+static Int getPartsExactBits(Int num, ShadowValue* sv, const Double* x, Int exactBits) {
+	Double org;
+	Double orgParts[QD_MAX_PARTS];
+	Double diff[QD_MAX_PARTS];
+	mpfr_exp_t xExp, diffExp;
+
+	if (clo_shadowBackend == Sb_COND) {
+		/* a bound below 2^-k leaves k correct bits */
+		if (x[COND_ERROR] == 0) {
+			return exactBits;
+		}
+		if (!isRegularDouble(x[COND_ERROR]) || nativeExp(x[COND_ERROR]) >= 0) {
+			return 0;
+		}
+		return limitExactBits(sv, -nativeExp(x[COND_ERROR]));
+	}
+	if (!readNativeTemp(num, &org)) {
+		VG_(tool_panic)("Unhandled case in getPartsExactBits\n");
+	}
+	/* zero, subnormals, infinity and NaN are only correct if they are equal */
+	if (!isRegularDouble(org) || !partsExp(x, &xExp)) {
+		return partsEqualDouble(x, org) ? exactBits : 0;
+	}
+	if (nativeExp(org) != xExp) {
+		return 0;
+	}
+	partsSetDouble(org, orgParts);
+	partsSub(False, x, orgParts, diff);
+	if (partsEqualDouble(diff, 0)) {
+		return exactBits;
 	}
+	if (!partsExp(diff, &diffExp)) {
+		/* a subnormal difference of doubles, scaled by 2^64 */
+		diffExp = nativeExp(diff[0] * 18446744073709551616.0) - 64;
+	}
+	return limitExactBits(sv, abs(xExp - diffExp) - 2);
+}
 
-	if (addr) {
-		IRStmt* store = IRStmt_Store(Iend_LE, mkU64(&(sTmp[num]->type)), mkU32(type));
-		addStmtToIRSB(sb, store);
+/* like getExactBits for the native values of --sim-original, the
+   difference of two doubles with the same exponent is exact */
+static Int getSimulatedExactBits(Int num, ShadowValue* sv, Double x, Int exactBits) {
+	Double org;
 
-		IRExpr* rdTmp = IRExpr_RdTmp(tmp);
-		store = IRStmt_Store(Iend_LE, addr, rdTmp);
-		addStmtToIRSB(sb, store);
-	} else {
-		VG_(tool_panic)("Unhandled case in writeSTemp\n");
+	if (!readNativeTemp(num, &org)) {
+		VG_(tool_panic)("Unhandled case in getSimulatedExactBits\n");
+	}
+	if (x == org) {
+		return exactBits;
+	}
+	if (!isRegularDouble(x) || !isRegularDouble(org) || nativeExp(x) != nativeExp(org) ||
+		!isRegularDouble(x - org))
+	{
+		return 0;
 	}
+	return limitExactBits(sv, abs(nativeExp(x) - nativeExp(x - org)) - 2);
 }
 
+/* With --adaptive-precision, the shadow values start as double-double.
+   A cancellation of more bits than PROMOTE_CANCEL_LIMIT shows that the
+   error of the double-double arguments may reach the bits of the original
+   value. The site and the sites of the arguments are then promoted, so
+   that their results are computed with MPFR from now on. Results with an
+   argument in MPFR are computed with MPFR as well. */
 static __inline__
-void readSTemp(Int num, mpfr_t* fp) {
-	IRType type = sTmp[num]->type;
-	switch (type) {
-		case Ity_F32:
-			if (clo_simulateOriginal) mpfr_set_prec(*fp, 24);
-			mpfr_set_flt(*fp, sTmp[num]->Val.F32, STD_RND);
-			break;
-		case Ity_F64:
-			if (clo_simulateOriginal) mpfr_set_prec(*fp, 53);
-			mpfr_set_d(*fp, sTmp[num]->Val.F64, STD_RND);
-			break;
-		case Ity_V128:
-			/* Not a general solution, because this does not work if vectors are used 
-			   e.g. two/four additions with one SSE instruction */
-			if (sTmp[num]->U128[1] == 0) {
-				if (clo_simulateOriginal) mpfr_set_prec(*fp, 24);
+Bool useParts(Addr addr, ShadowValue* arg1, ShadowValue* arg2) {
+	if (shadowParts == 0) {
+		return False;
+	}
+	if (!clo_adaptivePrecision) {
+		return True;
+	}
+	if ((arg1 && arg1->data->repr == Sr_MPFR) || (arg2 && arg2->data->repr == Sr_MPFR) ||
+		VG_(HT_lookup)(promotedSites, addr) != NULL)
+	{
+		promotedOps++;
+		return False;
+	}
+	return True;
+}
 
-				Float* flp = &(sTmp[num]->U128[0]);
-				mpfr_set_flt(*fp, *flp, STD_RND);
-			} else {
-				if (clo_simulateOriginal) mpfr_set_prec(*fp, 53);
+static void promoteSite(Addr site) {
+	if (site == 0) {
+		return;
+	}
+	PromotedSite* ps = VG_(HT_lookup)(promotedSites, site);
+	if (ps == NULL) {
+		ps = VG_(malloc)("fd.promoteSite.1", sizeof(PromotedSite));
+		ps->key = site;
+		ps->count = 0;
+		VG_(HT_add_node)(promotedSites, ps);
+	}
+	ps->count++;
+}
 
-				ULong ul = sTmp[num]->U128[1];
-				ul <<= 32;
-				ul |= sTmp[num]->U128[0];
-				Double* db = &ul;
-				mpfr_set_d(*fp, *db, STD_RND);
-			}
-			break;
-		default:
-			VG_(tool_panic)("Unhandled case in readSTemp\n");
-			break;
+static __inline__
+void checkPromotion(Addr addr, mpfr_exp_t canceled, Addr arg1origin, Addr arg2origin) {
+	if (clo_adaptivePrecision && canceled > PROMOTE_CANCEL_LIMIT) {
+		promoteSite(addr);
+		promoteSite(arg1origin);
+		promoteSite(arg2origin);
 	}
 }
 
-static Bool isOpFloat(IROp op) {
+/* With --exact-sums, an addition or subtraction that adds to its own
+   result, like s = s + x in a loop, becomes a summation site after
+   ACC_DETECT_LIMIT times. Its results are then kept in accumulators, so
+   the sum is exact and a step only needs integer additions. The sum is
+   rounded to MPFR by materialize when another operation reads it. The
+   addend must be exact or a sum of its own, otherwise NULL is returned
+   and the operation is computed with MPFR as usual. inPlace is set to
+   the data of the sum if its accumulator was updated in place, sample if
+   the relative error of the step is computed, see updateAccMeanValue. */
+static Accumulator* accumulate(OpDesc* desc, IROp op, Int num1, Bool isConst1, ShadowValue* arg1,
+	Int num2, Bool isConst2, ShadowValue* arg2, mpfr_exp_t* canceled, ShadowData** inPlace, Bool* sample)
+{
+	Addr addr = desc->key;
+	Bool isSub;
 	switch (op) {
-		/* unary float */
-		case Iop_Sqrt32F0x4:
-		case Iop_NegF32:
-		case Iop_AbsF32:
-		/* binary float */
 		case Iop_Add32F0x4:
-		case Iop_Sub32F0x4:
-		case Iop_Mul32F0x4:
-		case Iop_Div32F0x4:
-		case Iop_Min32F0x4:
-		case Iop_Max32F0x4:
-			return True;
-		/* unary double */
-		case Iop_Sqrt64F0x2:
-		case Iop_NegF64:
-		case Iop_AbsF64:
-		/* binary double */
 		case Iop_Add64F0x2:
-		case Iop_Sub64F0x2:
-		case Iop_Mul64F0x2:
-		case Iop_Div64F0x2:
-		case Iop_Min64F0x2:
-		case Iop_Max64F0x2:
-		/* ternary double */
 		case Iop_AddF64:
+			isSub = False;
+			break;
+		case Iop_Sub32F0x4:
+		case Iop_Sub64F0x2:
 		case Iop_SubF64:
-		case Iop_MulF64:
-		case Iop_DivF64:
-			return False;
+			isSub = True;
+			break;
 		default:
-			// TODO warn
-			//VG_(tool_panic)("Unhandled operation in isOpFloat\n");
-			return False;
+			return NULL;
+	}
+
+	ShadowValue* sum;
+	ShadowValue* addend;
+	Int sumNum, addNum;
+	Bool addConst;
+	if (arg1 && dataCold(arg1->data)->origin == addr) {
+		sum = arg1;
+		sumNum = num1;
+		addend = arg2;
+		addNum = num2;
+		addConst = isConst2;
+	} else if (!isSub && arg2 && dataCold(arg2->data)->origin == addr) {
+		sum = arg2;
+		sumNum = num2;
+		addend = arg1;
+		addNum = num1;
+		addConst = isConst1;
+	} else {
+		return NULL;
 	}
+
+	AccSite* as = VG_(HT_lookup)(accSites, addr);
+	if (as == NULL) {
+		as = VG_(malloc)("fd.accumulate.1", sizeof(AccSite));
+		as->key = addr;
+		as->count = 0;
+		VG_(HT_add_node)(accSites, as);
+	}
+	as->count++;
+	if (as->count < ACC_DETECT_LIMIT) {
+		return NULL;
+	}
+
+	Double x = 0;
+	Accumulator* addAcc = NULL;
+	if (addend && addend->data->repr == Sr_ACC) {
+		addAcc = dataAcc(addend->data);
+	} else if (!readExactArg(addNum, addConst, addend, &x) || !isFiniteDouble(x)) {
+		return NULL;
+	}
+
+	*sample = (as->count - ACC_DETECT_LIMIT) % ACC_MEAN_INTERVAL == 0;
+
+	/* A sum that only the argument holds and no later statement reads is
+	   updated in place and its data becomes the result. If the signs of
+	   the sum and the addend agree nothing cancels, so the old sum is not
+	   needed for the exact bits of the arguments either. */
+	Bool fresh;
+	Accumulator* acc;
+	*inPlace = NULL;
+	if (sum->data->repr == Sr_ACC && sum->data->refCount == 1 && ((desc->lastUse >> sumNum) & 1) &&
+			(addend == NULL || addend->data != sum->data) &&
+			mpfr_get_prec(sum->data->value) == desc->prec &&
+			(!clo_bad_cancellations ||
+			accIsNegative(dataAcc(sum->data)) == ((addAcc ? accIsNegative(addAcc) : x < 0) != isSub))) {
+		acc = dataAcc(sum->data);
+		*inPlace = sum->data;
+		accInPlace++;
+	} else if (sum->data->repr == Sr_ACC) {
+		acc = slabAlloc(&accSlab, &fresh);
+		accCopy(acc, dataAcc(sum->data));
+	} else if (sum->data->repr == Sr_EXACT && isFiniteDouble(sum->data->native)) {
+		acc = slabAlloc(&accSlab, &fresh);
+		accClear(acc);
+		accAddDouble(acc, sum->data->native, False);
+	} else {
+		acc = slabAlloc(&accSlab, &fresh);
+		materialize(sum->data);
+		if (!mpfrToAcc(&(sum->data->value), acc)) {
+			slabFree(&accSlab, acc);
+			return NULL;
+		}
+	}
+
+	Long sumExp, addExp, resExp;
+	Bool regular = accExp(acc, &sumExp);
+	if (addAcc) {
+		regular = accExp(addAcc, &addExp) && regular;
+		accAdd(acc, addAcc, isSub);
+	} else {
+		regular = isRegularDouble(x) && regular;
+		addExp = nativeExp(x);
+		accAddDouble(acc, x, isSub);
+	}
+	*canceled = 0;
+	if (regular && accExp(acc, &resExp)) {
+		Long max = sumExp > addExp ? sumExp : addExp;
+		if (resExp < max) {
+			*canceled = max - resExp;
+		}
+	}
+	return acc;
 }
 
-static VG_REGPARM(2) void processUnOp(Addr addr, UWord ca) {
+static VG_REGPARM(3) void processUnOp(OpDesc* desc, ULong argBits, ULong orgBits) {
 	if (!clo_analyze) return;
 
-	Int constArgs = (Int)ca;
+	Addr addr = desc->key;
+	IROp op = desc->op;
+	Int constArgs = (Int)desc->constArgs;
+	setArgBits(desc, constArgs, 0, argBits);
 	ULong argOpCount = 0;
 	Addr argOrigin = 0;
 	mpfr_exp_t argCanceled = 0;
 	Addr argCancelOrigin = 0;
- 
-	if (clo_simulateOriginal) {
-		if (isOpFloat(binOpArgs->op)) {
-			mpfr_set_prec(arg1tmpX, 24);
-		} else {
-			mpfr_set_prec(arg1tmpX, 53);
-		}
+
+	ShadowValue* argTmp = (constArgs & 0x1) ? NULL : getTemp(desc->arg[0]);
+	if (argTmp) {
+		argOpCount = dataCold(argTmp->data)->opCount;
+		argOrigin = dataCold(argTmp->data)->origin;
+		argCanceled = dataCold(argTmp->data)->canceled;
+		argCancelOrigin = dataCold(argTmp->data)->cancelOrigin;
 	}
 
-	if (constArgs & 0x1) {
-		readSConst(0, &(arg1tmpX));
+	Double native, nativeRes;
+	Double parts[QD_MAX_PARTS];
+	Bool exact;
+	if (clo_simulateOriginal) {
+		/* the simulated result is kept like an exact one */
+		readSimulatedArg(0, constArgs & 0x1, argTmp, isOpFloat(op), &(arg1tmpX), &native);
+		nativeRes = simulateUnOp(op, isOpFloat(op), native);
+		exact = True;
 	} else {
-		ShadowValue* argTmp = getTemp(unOpArgs->arg);
-		if (argTmp) {
-			mpfr_set(arg1tmpX, argTmp->value, STD_RND);
-			argOpCount = argTmp->opCount;
-			argOrigin = argTmp->origin;
-			argCanceled = argTmp->canceled;
-			argCancelOrigin = argTmp->cancelOrigin;
-		} else {
-			readSTemp(0, &(arg1tmpX));
+		exact = op != Iop_Sqrt32F0x4 && op != Iop_Sqrt64F0x2 &&
+			readExactArg(0, constArgs & 0x1, argTmp, &native);
+		if (exact) {
+			/* negation and absolute value are always exact */
+			nativeRes = simulateUnOp(op, False, native);
+			exactOps++;
 		}
 	}
-
-	ShadowValue* res = setTemp(unOpArgs->wrTmp);
-	if (clo_simulateOriginal) {
-		if (isOpFloat(binOpArgs->op)) {
-			mpfr_set_prec(res->value, 24);
-		} else {
-			mpfr_set_prec(res->value, 53);
+	Bool inParts = !exact && useParts(addr, argTmp, NULL);
+	if (inParts) {
+		readPartsArg(0, constArgs & 0x1, argTmp, &(arg1tmpX), parts);
+	} else if (!exact) {
+		readShadowArg(0, constArgs & 0x1, argTmp, &(arg1tmpX));
+		if (clo_checkPrecision > 0) {
+			readLaneArg(0, constArgs & 0x1, argTmp, &(arg1laneX));
 		}
 	}
-	res->opCount = argOpCount + 1;
-	res->origin = addr;
+
+	ShadowValue* res = setTemp(desc->wrTmp);
+	ShadowData* rd = newResult(res, desc->prec);
+	dataCold(rd)->opCount = argOpCount + 1;
+	dataCold(rd)->origin = addr;
 
 	fpOps++;
 
-	IROp op = unOpArgs->op;
-	switch (op) {
+	if (exact) {
+		setExact(rd, nativeRes);
+	} else if (inParts) {
+		setParts(rd);
+		switch (op) {
+			case Iop_Sqrt32F0x4:
+			case Iop_Sqrt64F0x2:
+				partsSqrt(isOpFloat(op), parts, dataParts(rd));
+				break;
+			case Iop_NegF32:
+			case Iop_NegF64:
+				partsNeg(parts, dataParts(rd));
+				break;
+			case Iop_AbsF32:
+			case Iop_AbsF64:
+				partsAbs(parts, dataParts(rd));
+				break;
+			default:
+				VG_(tool_panic)("Unhandled case in processUnOp\n");
+				break;
+		}
+	} else switch (op) {
 		case Iop_Sqrt32F0x4:
 		case Iop_Sqrt64F0x2:
-			mpfr_sqrt(res->value, arg1tmpX, STD_RND);
+			mpfr_sqrt(rd->value, arg1tmpX, STD_RND);
 			break;
 		case Iop_NegF32:
 		case Iop_NegF64:
-			mpfr_neg(res->value, arg1tmpX, STD_RND);
+			mpfr_neg(rd->value, arg1tmpX, STD_RND);
 			break;
 		case Iop_AbsF32:
 		case Iop_AbsF64:
-			mpfr_abs(res->value, arg1tmpX, STD_RND);
+			mpfr_abs(rd->value, arg1tmpX, STD_RND);
 			break;
 		default:
 			VG_(tool_panic)("Unhandled case in processUnOp\n");
 			break;
 	}
+	if (clo_checkPrecision > 0 && !exact) {
+		computeLane(op, checkLane(rd), &(arg1laneX), NULL);
+	}
 
-	res->canceled = argCanceled;
-	res->cancelOrigin = argCancelOrigin;
+	dataCold(rd)->canceled = argCanceled;
+	dataCold(rd)->cancelOrigin = argCancelOrigin;
 
 	if (clo_computeMeanValue) {
-		if (isOpFloat(unOpArgs->op)) {
-			mpfr_set_flt(meanOrg, unOpArgs->orgFloat, STD_RND);
+		if (exact) {
+			updateNativeMeanValue(addr, op, nativeRes,
+				orgValue(op, orgBits), 0, argOrigin, 0, 0);
+		} else if (inParts) {
+			updatePartsMeanValue(addr, op, dataParts(rd),
+				orgValue(op, orgBits), 0, argOrigin, 0, 0);
 		} else {
-			mpfr_set_d(meanOrg, unOpArgs->orgDouble, STD_RND);
+			mpfr_set_d(meanOrg, orgValue(op, orgBits), STD_RND);
+			updateMeanValue(addr, op, &(rd->value), 0, argOrigin, 0, 0);
+			if (clo_checkPrecision > 0) {
+				checkLanes(addr, checkLane(rd));
+			}
 		}
-		updateMeanValue(addr, unOpArgs->op, &(res->value), 0, argOrigin, 0, 0);
 	}
 }
 
@@ -863,56 +2917,23 @@ static void instrumentUnOp(IRSB* sb, IRTypeEnv* env, Addr addr, IRTemp wrTemp, I
 	IRExpr* arg = unop->Iex.Unop.arg;
 	tl_assert(arg->tag == Iex_RdTmp || arg->tag == Iex_Const);
 
-	IROp op = unop->Iex.Unop.op;
-	IRStmt* store = IRStmt_Store(Iend_LE, mkU64(&(unOpArgs->op)), mkU32(op));
-	addStmtToIRSB(sb, store);
-	store = IRStmt_Store(Iend_LE, mkU64(&(unOpArgs->wrTmp)), mkU32(wrTemp));
-	addStmtToIRSB(sb, store);
-
-	Int constArgs = 0;
-	
-	if (arg->tag == Iex_RdTmp) {
-		if (argTmpInstead >= 0) {
-			store = IRStmt_Store(Iend_LE, mkU64(&(unOpArgs->arg)), mkU32(argTmpInstead));
-		} else {
-			store = IRStmt_Store(Iend_LE, mkU64(&(unOpArgs->arg)), mkU32(unop->Iex.Unop.arg->Iex.RdTmp.tmp));
-		}
-		addStmtToIRSB(sb, store);
-
-		writeSTemp(sb, env, arg->Iex.RdTmp.tmp, 0);
-	} else {
-		tl_assert(arg->tag == Iex_Const);
-		writeSConst(sb, arg->Iex.Const.con, 0);
-		constArgs |= 0x1;
-	}
-
-	if (isOpFloat(op)) {
-		store = IRStmt_Store(Iend_LE, mkU64(&(unOpArgs->orgFloat)), IRExpr_RdTmp(wrTemp));
-		addStmtToIRSB(sb, store);
-	} else {
-		store = IRStmt_Store(Iend_LE, mkU64(&(unOpArgs->orgDouble)), IRExpr_RdTmp(wrTemp));
-		addStmtToIRSB(sb, store);
-	}
+	OpDesc desc;
+	initOpDesc(&desc, addr, unop->Iex.Unop.op, wrTemp);
+	setDescArg(&desc, env, arg, 0, argTmpInstead);
 
-	IRExpr** argv = mkIRExprVec_2(mkU64(addr), mkU64(constArgs));
-	IRDirty* di = unsafeIRDirty_0_N(2, "processUnOp", VG_(fnptr_to_fnentry)(&processUnOp), argv);
+	IRExpr** argv = mkIRExprVec_3(mkU64((Addr)internOpDesc(&desc)), tempBits(sb, env, arg),
+		tempBits(sb, env, IRExpr_RdTmp(wrTemp)));
+	IRDirty* di = unsafeIRDirty_0_N(3, "processUnOp", VG_(fnptr_to_fnentry)(&processUnOp), argv);
 	addStmtToIRSB(sb, IRStmt_Dirty(di));
 }
 
-static VG_REGPARM(2) void processBinOp(Addr addr, UWord ca) {
+static FD_ALWAYS_INLINE
+void processBinOpBody(OpDesc* desc, IROp op, Int constArgs, ULong arg1bits, ULong arg2bits, ULong orgBits) {
 	if (!clo_analyze) return;
 
-	Int constArgs = (Int)ca;
-
-	if (clo_simulateOriginal) {
-		if (isOpFloat(binOpArgs->op)) {
-			mpfr_set_prec(arg1tmpX, 24);
-			mpfr_set_prec(arg2tmpX, 24);
-		} else {
-			mpfr_set_prec(arg1tmpX, 53);
-			mpfr_set_prec(arg2tmpX, 53);
-		}
-	}
+	Addr addr = desc->key;
+	setArgBits(desc, constArgs, 0, arg1bits);
+	setArgBits(desc, constArgs, 1, arg2bits);
 
 	ULong arg1opCount = 0;
 	ULong arg2opCount = 0;
@@ -925,7 +2946,7 @@ static VG_REGPARM(2) void processBinOp(Addr addr, UWord ca) {
 	Addr arg2CancelOrigin = 0;
 
 	Int exactBitsArg1, exactBitsArg2;
-	if (isOpFloat(binOpArgs->op)) {
+	if (isOpFloat(op)) {
 		exactBitsArg1 = 23;
 		exactBitsArg2 = 23;
 	} else {
@@ -933,119 +2954,196 @@ static VG_REGPARM(2) void processBinOp(Addr addr, UWord ca) {
 		exactBitsArg2 = 52;
 	}
 
-	if (constArgs & 0x1) {
-		readSConst(0, &(arg1tmpX));
-	} else {
-		ShadowValue* arg1tmp = getTemp(binOpArgs->arg1);
-		if (arg1tmp) {
-			mpfr_set(arg1tmpX, arg1tmp->value, STD_RND);
-			arg1opCount = arg1tmp->opCount;
-			arg1origin = arg1tmp->origin;
-			arg1canceled = arg1tmp->canceled;
-			arg1CancelOrigin = arg1tmp->cancelOrigin;
-
-			if (clo_bad_cancellations) {
-				readSTemp(0, &cancelTemp);
-				if (mpfr_get_exp(cancelTemp) == mpfr_get_exp(arg1tmpX)) {
-					mpfr_sub(cancelTemp, arg1tmpX, cancelTemp, STD_RND);
-					if (mpfr_cmp_ui(cancelTemp, 0) != 0) {
-						exactBitsArg1 = abs(mpfr_get_exp(arg1tmpX) - mpfr_get_exp(cancelTemp)) - 2;
-						if (arg1tmp->orgType == Ot_FLOAT && exactBitsArg1 > 23) {
-							exactBitsArg1 = 23;
-						} else if (arg1tmp->orgType == Ot_DOUBLE && exactBitsArg1 > 52) {
-							exactBitsArg1 = 52;
-						}
-					}
-				} else {
-					exactBitsArg1 = 0;
-				}
+	ShadowValue* arg1tmp = (constArgs & 0x1) ? NULL : getTemp(desc->arg[0]);
+	if (arg1tmp) {
+		arg1opCount = dataCold(arg1tmp->data)->opCount;
+		arg1origin = dataCold(arg1tmp->data)->origin;
+		arg1canceled = dataCold(arg1tmp->data)->canceled;
+		arg1CancelOrigin = dataCold(arg1tmp->data)->cancelOrigin;
+	}
+	ShadowValue* arg2tmp = (constArgs & 0x2) ? NULL : getTemp(desc->arg[1]);
+	if (arg2tmp) {
+		arg2opCount = dataCold(arg2tmp->data)->opCount;
+		arg2origin = dataCold(arg2tmp->data)->origin;
+		arg2canceled = dataCold(arg2tmp->data)->canceled;
+		arg2CancelOrigin = dataCold(arg2tmp->data)->cancelOrigin;
+	}
+
+	Double native1, native2, nativeRes;
+	Double parts1[QD_MAX_PARTS], parts2[QD_MAX_PARTS];
+	Bool exact;
+	if (clo_simulateOriginal) {
+		/* the simulated result is kept like an exact one */
+		readSimulatedArg(0, constArgs & 0x1, arg1tmp, isOpFloat(op), &(arg1tmpX), &native1);
+		readSimulatedArg(1, constArgs & 0x2, arg2tmp, isOpFloat(op), &(arg2tmpX), &native2);
+		nativeRes = simulateBinOp(op, isOpFloat(op), native1, native2);
+		exact = True;
+
+		if (clo_bad_cancellations) {
+			if (arg1tmp) {
+				exactBitsArg1 = getSimulatedExactBits(0, arg1tmp, native1, exactBitsArg1);
+			}
+			if (arg2tmp) {
+				exactBitsArg2 = getSimulatedExactBits(1, arg2tmp, native2, exactBitsArg2);
 			}
-		} else {
-			readSTemp(0, &(arg1tmpX));
+		}
+	} else {
+		exact = readExactArg(0, constArgs & 0x1, arg1tmp, &native1) &&
+			readExactArg(1, constArgs & 0x2, arg2tmp, &native2) &&
+			exactBinOp(op, isOpFloat(op), native1, native2, &nativeRes);
+		if (exact) {
+			exactOps++;
 		}
 	}
+	Accumulator* acc = NULL;
+	ShadowData* accData = NULL;
+	Bool accSample = False;
+	if (!exact && clo_exactSums) {
+		acc = accumulate(desc, op, 0, constArgs & 0x1, arg1tmp, 1, constArgs & 0x2, arg2tmp, &canceled, &accData, &accSample);
+	}
+	Bool inParts = !exact && acc == NULL && useParts(addr, arg1tmp, arg2tmp);
 
-	if (constArgs & 0x2) {
-		readSConst(1, &(arg2tmpX));
-	} else {
-		ShadowValue* arg2tmp = getTemp(binOpArgs->arg2);
-		if (arg2tmp) {
-			mpfr_set(arg2tmpX, arg2tmp->value, STD_RND);
-			arg2opCount = arg2tmp->opCount;
-			arg2origin = arg2tmp->origin;
-			arg2canceled = arg2tmp->canceled;
-			arg2CancelOrigin = arg2tmp->cancelOrigin;
-
-			if (clo_bad_cancellations) {
-				readSTemp(1, &cancelTemp);
-				if (mpfr_get_exp(cancelTemp) == mpfr_get_exp(arg2tmpX)) {
-					mpfr_sub(cancelTemp, arg2tmpX, cancelTemp, STD_RND);
-					if (mpfr_cmp_ui(cancelTemp, 0) != 0) {
-						exactBitsArg2 = abs(mpfr_get_exp(arg2tmpX) - mpfr_get_exp(cancelTemp)) - 2;
-						if (arg2tmp->orgType == Ot_FLOAT && exactBitsArg2 > 23) {
-							exactBitsArg2 = 23;
-						} else if (arg2tmp->orgType == Ot_DOUBLE && exactBitsArg2 > 52) {
-							exactBitsArg2 = 52;
-						}
-					}
-				} else {
-					exactBitsArg2 = 0;
-				}
+	if (inParts) {
+		readPartsArg(0, constArgs & 0x1, arg1tmp, &(arg1tmpX), parts1);
+		readPartsArg(1, constArgs & 0x2, arg2tmp, &(arg2tmpX), parts2);
+
+		if (clo_bad_cancellations) {
+			if (arg1tmp && arg1tmp->data->repr != Sr_EXACT) {
+				exactBitsArg1 = getPartsExactBits(0, arg1tmp, parts1, exactBitsArg1);
+			}
+			if (arg2tmp && arg2tmp->data->repr != Sr_EXACT) {
+				exactBitsArg2 = getPartsExactBits(1, arg2tmp, parts2, exactBitsArg2);
 			}
-		} else {
-			readSTemp(1, &(arg2tmpX));
 		}
-	}
+	} else if (acc) {
+		/* the original values of the arguments are only compared if the sum cancels */
+		if (clo_bad_cancellations && canceled > 0) {
+			if (arg1tmp && arg1tmp->data->repr != Sr_EXACT) {
+				readShadowArg(0, constArgs & 0x1, arg1tmp, &(arg1tmpX));
+				exactBitsArg1 = getExactBits(0, arg1tmp, &(arg1tmpX), exactBitsArg1);
+			}
+			if (arg2tmp && arg2tmp->data->repr != Sr_EXACT) {
+				readShadowArg(1, constArgs & 0x2, arg2tmp, &(arg2tmpX));
+				exactBitsArg2 = getExactBits(1, arg2tmp, &(arg2tmpX), exactBitsArg2);
+			}
+		}
+	} else if (!exact) {
+		readShadowArg(0, constArgs & 0x1, arg1tmp, &(arg1tmpX));
+		readShadowArg(1, constArgs & 0x2, arg2tmp, &(arg2tmpX));
+		if (clo_checkPrecision > 0) {
+			readLaneArg(0, constArgs & 0x1, arg1tmp, &(arg1laneX));
+			readLaneArg(1, constArgs & 0x2, arg2tmp, &(arg2laneX));
+		}
 
-	ShadowValue* res = setTemp(binOpArgs->wrTmp);
-	if (clo_simulateOriginal) {
-		if (isOpFloat(binOpArgs->op)) {
-			mpfr_set_prec(res->value, 24);
-		} else {
-			mpfr_set_prec(res->value, 53);
+		/* the original value of an exact argument has all bits correct */
+		if (clo_bad_cancellations) {
+			if (arg1tmp && arg1tmp->data->repr != Sr_EXACT) {
+				exactBitsArg1 = getExactBits(0, arg1tmp, &(arg1tmpX), exactBitsArg1);
+			}
+			if (arg2tmp && arg2tmp->data->repr != Sr_EXACT) {
+				exactBitsArg2 = getExactBits(1, arg2tmp, &(arg2tmpX), exactBitsArg2);
+			}
 		}
 	}
-	res->opCount = 1;
+
+	ShadowValue* res = setTemp(desc->wrTmp);
+	ShadowData* rd = accData ? reuseResult(res, accData) : newResult(res, desc->prec);
+	dataCold(rd)->opCount = 1;
 	if (arg1opCount > arg2opCount) {
-		res->opCount += arg1opCount;
+		dataCold(rd)->opCount += arg1opCount;
 	} else {
-		res->opCount += arg2opCount;
+		dataCold(rd)->opCount += arg2opCount;
 	}
-	res->origin = addr;
+	dataCold(rd)->origin = addr;
 
 	fpOps++;
 
-	switch (binOpArgs->op) {
+	if (exact) {
+		setExact(rd, nativeRes);
+		switch (op) {
+			case Iop_Add32F0x4:
+			case Iop_Add64F0x2:
+			case Iop_Sub32F0x4:
+			case Iop_Sub64F0x2:
+				canceled = getNativeCanceledBits(nativeRes, native1, native2);
+				break;
+			default:
+				break;
+		}
+	} else if (acc) {
+		setAcc(rd, acc);
+	} else if (inParts) {
+		Double* r = dataParts(rd);
+		setParts(rd);
+		switch (op) {
+			case Iop_Add32F0x4:
+			case Iop_Add64F0x2:
+				partsAdd(isOpFloat(op), parts1, parts2, r);
+				canceled = getPartsCanceledBits(r, parts1, parts2);
+				break;
+			case Iop_Sub32F0x4:
+			case Iop_Sub64F0x2:
+				partsSub(isOpFloat(op), parts1, parts2, r);
+				canceled = getPartsCanceledBits(r, parts1, parts2);
+				break;
+			case Iop_Mul32F0x4:
+			case Iop_Mul64F0x2:
+				partsMul(isOpFloat(op), parts1, parts2, r);
+				break;
+			case Iop_Div32F0x4:
+			case Iop_Div64F0x2:
+				partsDiv(isOpFloat(op), parts1, parts2, r);
+				break;
+			case Iop_Min32F0x4:
+			case Iop_Min64F0x2:
+				partsMinMax(parts1, parts2, False, r);
+				break;
+			case Iop_Max32F0x4:
+			case Iop_Max64F0x2:
+				partsMinMax(parts1, parts2, True, r);
+				break;
+			default:
+				VG_(tool_panic)("Unhandled case in processBinOp\n");
+				break;
+		}
+	} else switch (op) {
 		case Iop_Add32F0x4:
 		case Iop_Add64F0x2:
-			mpfr_add(res->value, arg1tmpX, arg2tmpX, STD_RND);
-			canceled = getCanceledBits(&(res->value), &(arg1tmpX), &(arg2tmpX));
+			mpfr_add(rd->value, arg1tmpX, arg2tmpX, STD_RND);
+			canceled = getCanceledBits(&(rd->value), &(arg1tmpX), &(arg2tmpX));
 			break;
 		case Iop_Sub32F0x4:
 		case Iop_Sub64F0x2:
-			mpfr_sub(res->value, arg1tmpX, arg2tmpX, STD_RND);
-			canceled = getCanceledBits(&(res->value), &(arg1tmpX), &(arg2tmpX));
+			mpfr_sub(rd->value, arg1tmpX, arg2tmpX, STD_RND);
+			canceled = getCanceledBits(&(rd->value), &(arg1tmpX), &(arg2tmpX));
 			break;
 		case Iop_Mul32F0x4:
 		case Iop_Mul64F0x2:
-			mpfr_mul(res->value, arg1tmpX, arg2tmpX, STD_RND);
+			mpfr_mul(rd->value, arg1tmpX, arg2tmpX, STD_RND);
 			break;
 		case Iop_Div32F0x4:
 		case Iop_Div64F0x2:
-			mpfr_div(res->value, arg1tmpX, arg2tmpX, STD_RND);
+			mpfr_div(rd->value, arg1tmpX, arg2tmpX, STD_RND);
 			break;
 		case Iop_Min32F0x4:
 		case Iop_Min64F0x2:
-			mpfr_min(res->value, arg1tmpX, arg2tmpX, STD_RND);
+			mpfr_min(rd->value, arg1tmpX, arg2tmpX, STD_RND);
 			break;
 		case Iop_Max32F0x4:
 		case Iop_Max64F0x2:
-			mpfr_max(res->value, arg1tmpX, arg2tmpX, STD_RND);
+			mpfr_max(rd->value, arg1tmpX, arg2tmpX, STD_RND);
 			break;
 		default:
 			VG_(tool_panic)("Unhandled case in processBinOp\n");
 			break;
 	}
+	if (clo_checkPrecision > 0 && !exact) {
+		computeLane(op, checkLane(rd), &(arg1laneX), &(arg2laneX));
+	}
+
+	if (!exact) {
+		checkPromotion(addr, canceled, arg1origin, arg2origin);
+	}
 
 	mpfr_exp_t maxC = canceled;
 	Addr maxCorigin = addr;
@@ -1057,8 +3155,8 @@ static VG_REGPARM(2) void processBinOp(Addr addr, UWord ca) {
 		maxC = arg2canceled;
 		maxCorigin = arg2CancelOrigin;
 	}
-	res->canceled = maxC;
-	res->cancelOrigin = maxCorigin;
+	dataCold(rd)->canceled = maxC;
+	dataCold(rd)->cancelOrigin = maxCorigin;
 	
 	if (clo_computeMeanValue) {
 		UInt cancellationBadness = 0;
@@ -1069,95 +3167,109 @@ static VG_REGPARM(2) void processBinOp(Addr addr, UWord ca) {
 			}
 		}
 
-		if (isOpFloat(binOpArgs->op)) {
-			mpfr_set_flt(meanOrg, binOpArgs->orgFloat, STD_RND);
+		if (exact) {
+			updateNativeMeanValue(addr, op, nativeRes,
+				orgValue(op, orgBits),
+				canceled, arg1origin, arg2origin, cancellationBadness);
+		} else if (acc) {
+			updateAccMeanValue(addr, op, acc, accSample, orgValue(op, orgBits),
+				canceled, arg1origin, arg2origin, cancellationBadness);
+		} else if (inParts) {
+			updatePartsMeanValue(addr, op, dataParts(rd),
+				orgValue(op, orgBits),
+				canceled, arg1origin, arg2origin, cancellationBadness);
 		} else {
-			mpfr_set_d(meanOrg, binOpArgs->orgDouble, STD_RND);
+			mpfr_set_d(meanOrg, orgValue(op, orgBits), STD_RND);
+			updateMeanValue(addr, op, &(rd->value), canceled, arg1origin, arg2origin, cancellationBadness);
+			if (clo_checkPrecision > 0) {
+				checkLanes(addr, checkLane(rd));
+			}
 		}
-		updateMeanValue(addr, binOpArgs->op, &(res->value), canceled, arg1origin, arg2origin, cancellationBadness);
 	}
 }
 
-static void instrumentBinOp(IRSB* sb, IRTypeEnv* env, Addr addr, IRTemp wrTemp, IRExpr* binop, Int arg1tmpInstead, Int arg2tmpInstead) {
+/*
+	The scalar SSE arithmetic with two temporaries is most of the work, so
+	processBinOp is copied for each of these operations, the copies know
+	the operation and that no argument is a constant at compile time and
+	the switches on them disappear. instrumentBinOp selects the copy when
+	the operation is instrumented, other operations and shapes use the
+	generic helper.
+ */
+#define SPECIALIZED_BINOPS(_) \
+	_(Add32F0x4,	True) \
+	_(Sub32F0x4,	True) \
+	_(Mul32F0x4,	True) \
+	_(Div32F0x4,	True) \
+	_(Add64F0x2,	False) \
+	_(Sub64F0x2,	False) \
+	_(Mul64F0x2,	False) \
+	_(Div64F0x2,	False)
+
+#define SELECT_HELPER(_fn) \
+	*name = #_fn; \
+	return &_fn;
+
+static VG_REGPARM(3) void processBinOp(OpDesc* desc, ULong arg1bits, ULong arg2bits, ULong orgBits) {
+	processBinOpBody(desc, desc->op, (Int)desc->constArgs, arg1bits, arg2bits, orgBits);
+}
+
+#define BINOP_HELPER(_op, _float) \
+	static VG_REGPARM(3) void processBinOp_##_op(OpDesc* desc, ULong arg1bits, ULong arg2bits, ULong orgBits) { \
+		processBinOpBody(desc, Iop_##_op, 0x0, arg1bits, arg2bits, orgBits); \
+	}
+
+#define BINOP_CASE(_op, _float) \
+	case Iop_##_op: \
+		if (constArgs == 0x0) { SELECT_HELPER(processBinOp_##_op) } \
+		break;
+
+SPECIALIZED_BINOPS(BINOP_HELPER)
+
+static void* binOpHelper(IROp op, UInt constArgs, HChar** name) {
+	switch (op) {
+		SPECIALIZED_BINOPS(BINOP_CASE)
+		default:
+			break;
+	}
+	SELECT_HELPER(processBinOp)
+}
+
+static void instrumentBinOp(IRSB* sb, IRTypeEnv* env, Addr addr, IRTemp wrTemp, IRExpr* binop, Int arg1tmpInstead, Int arg2tmpInstead, UInt lastUse) {
 	tl_assert(binop->tag == Iex_Binop);
 
 	if (clo_ignoreLibraries && isInLibrary(addr)) {
 		return;
 	}
 
-	IROp op = binop->Iex.Binop.op;
 	IRExpr* arg1 = binop->Iex.Binop.arg1;
 	IRExpr* arg2 = binop->Iex.Binop.arg2;
 
 	tl_assert(arg1->tag == Iex_RdTmp || arg1->tag == Iex_Const);
 	tl_assert(arg2->tag == Iex_RdTmp || arg2->tag == Iex_Const);
 
-	Int constArgs = 0;
-
-	IRStmt* store = IRStmt_Store(Iend_LE, mkU64(&(binOpArgs->op)), mkU32(op));
-	addStmtToIRSB(sb, store);
-	store = IRStmt_Store(Iend_LE, mkU64(&(binOpArgs->wrTmp)), mkU32(wrTemp));
-	addStmtToIRSB(sb, store);
-
-	if (arg1->tag == Iex_RdTmp) {
-		if (arg1tmpInstead >= 0) {
-			store = IRStmt_Store(Iend_LE, mkU64(&(binOpArgs->arg1)), mkU32(arg1tmpInstead));
-		} else {
-			store = IRStmt_Store(Iend_LE, mkU64(&(binOpArgs->arg1)), mkU32(arg1->Iex.RdTmp.tmp));
-		}
-		addStmtToIRSB(sb, store);
-
-		writeSTemp(sb, env, arg1->Iex.RdTmp.tmp, 0);
-	} else {
-		tl_assert(arg1->tag == Iex_Const);
-
-		writeSConst(sb, arg1->Iex.Const.con, 0);
-		constArgs |= 0x1;
-	}
-	if (arg2->tag == Iex_RdTmp) {
-		if (arg2tmpInstead >= 0) {
-			store = IRStmt_Store(Iend_LE, mkU64(&(binOpArgs->arg2)), mkU32(arg2tmpInstead));
-		} else {
-			store = IRStmt_Store(Iend_LE, mkU64(&(binOpArgs->arg2)), mkU32(arg2->Iex.RdTmp.tmp));
-		}
-		addStmtToIRSB(sb, store);
-
-		writeSTemp(sb, env, arg2->Iex.RdTmp.tmp, 1);
-	} else {
-		tl_assert(arg2->tag == Iex_Const);
-
-		writeSConst(sb, arg2->Iex.Const.con, 1);
-		constArgs |= 0x2;
-	}
-
-	if (isOpFloat(op)) {
-		store = IRStmt_Store(Iend_LE, mkU64(&(binOpArgs->orgFloat)), IRExpr_RdTmp(wrTemp));
-		addStmtToIRSB(sb, store);
-	} else {
-		store = IRStmt_Store(Iend_LE, mkU64(&(binOpArgs->orgDouble)), IRExpr_RdTmp(wrTemp));
-		addStmtToIRSB(sb, store);
-	}
-
-	IRExpr** argv = mkIRExprVec_2(mkU64(addr), mkU64(constArgs));
-	IRDirty* di = unsafeIRDirty_0_N(2, "processBinOp", VG_(fnptr_to_fnentry)(&processBinOp), argv);
+	OpDesc desc;
+	initOpDesc(&desc, addr, binop->Iex.Binop.op, wrTemp);
+	setDescArg(&desc, env, arg1, 0, arg1tmpInstead);
+	setDescArg(&desc, env, arg2, 1, arg2tmpInstead);
+	desc.lastUse = lastUse;
+
+	IRExpr** argv = mkIRExprVec_4(mkU64((Addr)internOpDesc(&desc)), tempBits(sb, env, arg1),
+		tempBits(sb, env, arg2), tempBits(sb, env, IRExpr_RdTmp(wrTemp)));
+	HChar* name;
+	void* helper = binOpHelper(desc.op, desc.constArgs, &name);
+	IRDirty* di = unsafeIRDirty_0_N(3, name, VG_(fnptr_to_fnentry)(helper), argv);
 	addStmtToIRSB(sb, IRStmt_Dirty(di));
 }
 
-static VG_REGPARM(2) void processTriOp(Addr addr, UWord ca) {
+static VG_REGPARM(3) void processTriOp(OpDesc* desc, ULong arg2bits, ULong arg3bits, ULong orgBits) {
 	if (!clo_analyze) return;
 
-	Int constArgs = (Int)ca;
-	IROp op = triOpArgs->op;
-
-	if (clo_simulateOriginal) {
-		if (isOpFloat(binOpArgs->op)) {
-			mpfr_set_prec(arg2tmpX, 24);
-			mpfr_set_prec(arg3tmpX, 24);
-		} else {
-			mpfr_set_prec(arg2tmpX, 53);
-			mpfr_set_prec(arg3tmpX, 53);
-		}
-	}
+	Addr addr = desc->key;
+	IROp op = desc->op;
+	Int constArgs = (Int)desc->constArgs;
+	setArgBits(desc, constArgs, 1, arg2bits);
+	setArgBits(desc, constArgs, 2, arg3bits);
 
 	ULong arg2opCount = 0;
 	ULong arg3opCount = 0;
@@ -1170,7 +3282,7 @@ static VG_REGPARM(2) void processTriOp(Addr addr, UWord ca) {
 	Addr arg3CancelOrigin = 0;
 
 	Int exactBitsArg2, exactBitsArg3;
-	if (isOpFloat(binOpArgs->op)) {
+	if (isOpFloat(op)) {
 		exactBitsArg2 = 23;
 		exactBitsArg3 = 23;
 	} else {
@@ -1178,107 +3290,164 @@ static VG_REGPARM(2) void processTriOp(Addr addr, UWord ca) {
 		exactBitsArg3 = 52;
 	}
 
-	if (constArgs & 0x2) {
-		readSConst(1, &(arg2tmpX));
-	} else {
-		ShadowValue* arg2tmp = getTemp(triOpArgs->arg2);
-		if (arg2tmp) {
-			mpfr_set(arg2tmpX, arg2tmp->value, STD_RND);
-			arg2opCount = arg2tmp->opCount;
-			arg2origin = arg2tmp->origin;
-			arg2canceled = arg2tmp->canceled;
-			arg2CancelOrigin = arg2tmp->cancelOrigin;
-
-			if (clo_bad_cancellations) {
-				readSTemp(1, &cancelTemp);
-				if (mpfr_get_exp(cancelTemp) == mpfr_get_exp(arg2tmpX)) {
-					mpfr_sub(cancelTemp, arg2tmpX, cancelTemp, STD_RND);
-					if (mpfr_cmp_ui(cancelTemp, 0) != 0) {
-						exactBitsArg2 = abs(mpfr_get_exp(arg2tmpX) - mpfr_get_exp(cancelTemp)) - 2;
-						if (arg2tmp->orgType == Ot_FLOAT && exactBitsArg2 > 23) {
-							exactBitsArg2 = 23;
-						} else if (arg2tmp->orgType == Ot_DOUBLE && exactBitsArg2 > 52) {
-							exactBitsArg2 = 52;
-						}
-					}
-				} else {
-					exactBitsArg2 = 0;
-				}
+	ShadowValue* arg2tmp = (constArgs & 0x2) ? NULL : getTemp(desc->arg[1]);
+	if (arg2tmp) {
+		arg2opCount = dataCold(arg2tmp->data)->opCount;
+		arg2origin = dataCold(arg2tmp->data)->origin;
+		arg2canceled = dataCold(arg2tmp->data)->canceled;
+		arg2CancelOrigin = dataCold(arg2tmp->data)->cancelOrigin;
+	}
+	ShadowValue* arg3tmp = (constArgs & 0x4) ? NULL : getTemp(desc->arg[2]);
+	if (arg3tmp) {
+		arg3opCount = dataCold(arg3tmp->data)->opCount;
+		arg3origin = dataCold(arg3tmp->data)->origin;
+		arg3canceled = dataCold(arg3tmp->data)->canceled;
+		arg3CancelOrigin = dataCold(arg3tmp->data)->cancelOrigin;
+	}
+
+	/* an exact result does not depend on the rounding mode in arg1 */
+	Double native2, native3, nativeRes;
+	Double parts2[QD_MAX_PARTS], parts3[QD_MAX_PARTS];
+	Bool exact;
+	if (clo_simulateOriginal) {
+		/* the simulated result is kept like an exact one */
+		readSimulatedArg(1, constArgs & 0x2, arg2tmp, False, &(arg2tmpX), &native2);
+		readSimulatedArg(2, constArgs & 0x4, arg3tmp, False, &(arg3tmpX), &native3);
+		nativeRes = simulateBinOp(op, False, native2, native3);
+		exact = True;
+
+		if (clo_bad_cancellations) {
+			if (arg2tmp) {
+				exactBitsArg2 = getSimulatedExactBits(1, arg2tmp, native2, exactBitsArg2);
 			}
-		} else {
-			readSTemp(1, &(arg2tmpX));
+			if (arg3tmp) {
+				exactBitsArg3 = getSimulatedExactBits(2, arg3tmp, native3, exactBitsArg3);
+			}
+		}
+	} else {
+		exact = readExactArg(1, constArgs & 0x2, arg2tmp, &native2) &&
+			readExactArg(2, constArgs & 0x4, arg3tmp, &native3) &&
+			exactBinOp(op, False, native2, native3, &nativeRes);
+		if (exact) {
+			exactOps++;
 		}
 	}
+	Accumulator* acc = NULL;
+	ShadowData* accData = NULL;
+	Bool accSample = False;
+	if (!exact && clo_exactSums) {
+		acc = accumulate(desc, op, 1, constArgs & 0x2, arg2tmp, 2, constArgs & 0x4, arg3tmp, &canceled, &accData, &accSample);
+	}
+	Bool inParts = !exact && acc == NULL && useParts(addr, arg2tmp, arg3tmp);
 
-	if (constArgs & 0x4) {
-		readSConst(2, &(arg3tmpX));
-	} else {
-		ShadowValue* arg3tmp = getTemp(triOpArgs->arg3);
-		if (arg3tmp) {
-			mpfr_set(arg3tmpX, arg3tmp->value, STD_RND);
-			arg3opCount = arg3tmp->opCount;
-			arg3origin = arg3tmp->origin;
-			arg3canceled = arg3tmp->canceled;
-			arg3CancelOrigin = arg3tmp->cancelOrigin;
-
-			if (clo_bad_cancellations) {
-				readSTemp(2, &cancelTemp);
-				if (mpfr_get_exp(cancelTemp) == mpfr_get_exp(arg3tmpX)) {
-					mpfr_sub(cancelTemp, arg3tmpX, cancelTemp, STD_RND);
-					if (mpfr_cmp_ui(cancelTemp, 0) != 0) {
-						exactBitsArg3 = abs(mpfr_get_exp(arg3tmpX) - mpfr_get_exp(cancelTemp)) - 2;
-						if (arg3tmp->orgType == Ot_FLOAT && exactBitsArg3 > 23) {
-							exactBitsArg3 = 23;
-						} else if (arg3tmp->orgType == Ot_DOUBLE && exactBitsArg3 > 52) {
-							exactBitsArg3 = 52;
-						}
-					}
-				} else {
-					exactBitsArg3 = 0;
-				}
+	if (inParts) {
+		readPartsArg(1, constArgs & 0x2, arg2tmp, &(arg2tmpX), parts2);
+		readPartsArg(2, constArgs & 0x4, arg3tmp, &(arg3tmpX), parts3);
+
+		if (clo_bad_cancellations) {
+			if (arg2tmp && arg2tmp->data->repr != Sr_EXACT) {
+				exactBitsArg2 = getPartsExactBits(1, arg2tmp, parts2, exactBitsArg2);
+			}
+			if (arg3tmp && arg3tmp->data->repr != Sr_EXACT) {
+				exactBitsArg3 = getPartsExactBits(2, arg3tmp, parts3, exactBitsArg3);
+			}
+		}
+	} else if (acc) {
+		if (clo_bad_cancellations && canceled > 0) {
+			if (arg2tmp && arg2tmp->data->repr != Sr_EXACT) {
+				readShadowArg(1, constArgs & 0x2, arg2tmp, &(arg2tmpX));
+				exactBitsArg2 = getExactBits(1, arg2tmp, &(arg2tmpX), exactBitsArg2);
+			}
+			if (arg3tmp && arg3tmp->data->repr != Sr_EXACT) {
+				readShadowArg(2, constArgs & 0x4, arg3tmp, &(arg3tmpX));
+				exactBitsArg3 = getExactBits(2, arg3tmp, &(arg3tmpX), exactBitsArg3);
 			}
-		} else {
-			readSTemp(2, &(arg3tmpX));
 		}
-	}
+	} else if (!exact) {
+		readShadowArg(1, constArgs & 0x2, arg2tmp, &(arg2tmpX));
+		readShadowArg(2, constArgs & 0x4, arg3tmp, &(arg3tmpX));
+		if (clo_checkPrecision > 0) {
+			readLaneArg(1, constArgs & 0x2, arg2tmp, &(arg2laneX));
+			readLaneArg(2, constArgs & 0x4, arg3tmp, &(arg3laneX));
+		}
 
-	ShadowValue* res = setTemp(triOpArgs->wrTmp);
-	if (clo_simulateOriginal) {
-		if (isOpFloat(binOpArgs->op)) {
-			mpfr_set_prec(res->value, 24);
-		} else {
-			mpfr_set_prec(res->value, 53);
+		if (clo_bad_cancellations) {
+			if (arg2tmp && arg2tmp->data->repr != Sr_EXACT) {
+				exactBitsArg2 = getExactBits(1, arg2tmp, &(arg2tmpX), exactBitsArg2);
+			}
+			if (arg3tmp && arg3tmp->data->repr != Sr_EXACT) {
+				exactBitsArg3 = getExactBits(2, arg3tmp, &(arg3tmpX), exactBitsArg3);
+			}
 		}
 	}
-	res->opCount = 1;
+
+	ShadowValue* res = setTemp(desc->wrTmp);
+	ShadowData* rd = accData ? reuseResult(res, accData) : newResult(res, desc->prec);
+	dataCold(rd)->opCount = 1;
 	if (arg2opCount > arg3opCount) {
-		res->opCount += arg2opCount;
+		dataCold(rd)->opCount += arg2opCount;
 	} else {
-		res->opCount += arg3opCount;
+		dataCold(rd)->opCount += arg3opCount;
 	}
-	res->origin = addr;
+	dataCold(rd)->origin = addr;
 
 	fpOps++;
 
-	switch (op) {
+	if (exact) {
+		setExact(rd, nativeRes);
+		if (op == Iop_AddF64 || op == Iop_SubF64) {
+			canceled = getNativeCanceledBits(nativeRes, native2, native3);
+		}
+	} else if (acc) {
+		setAcc(rd, acc);
+	} else if (inParts) {
+		Double* r = dataParts(rd);
+		setParts(rd);
+		switch (op) {
+			case Iop_AddF64:
+				partsAdd(False, parts2, parts3, r);
+				canceled = getPartsCanceledBits(r, parts2, parts3);
+				break;
+			case Iop_SubF64:
+				partsSub(False, parts2, parts3, r);
+				canceled = getPartsCanceledBits(r, parts2, parts3);
+				break;
+			case Iop_MulF64:
+				partsMul(False, parts2, parts3, r);
+				break;
+			case Iop_DivF64:
+				partsDiv(False, parts2, parts3, r);
+				break;
+			default:
+				VG_(tool_panic)("Unhandled case in processTriOp");
+				break;
+		}
+	} else switch (op) {
 		case Iop_AddF64:
-			mpfr_add(res->value, arg2tmpX, arg3tmpX, STD_RND);
-			canceled = getCanceledBits(&(res->value), &(arg2tmpX), &(arg3tmpX));
+			mpfr_add(rd->value, arg2tmpX, arg3tmpX, STD_RND);
+			canceled = getCanceledBits(&(rd->value), &(arg2tmpX), &(arg3tmpX));
 			break;
 		case Iop_SubF64:
-			mpfr_sub(res->value, arg2tmpX, arg3tmpX, STD_RND);
-			canceled = getCanceledBits(&(res->value), &(arg2tmpX), &(arg3tmpX));
+			mpfr_sub(rd->value, arg2tmpX, arg3tmpX, STD_RND);
+			canceled = getCanceledBits(&(rd->value), &(arg2tmpX), &(arg3tmpX));
 			break;
 		case Iop_MulF64:
-			mpfr_mul(res->value, arg2tmpX, arg3tmpX, STD_RND);
+			mpfr_mul(rd->value, arg2tmpX, arg3tmpX, STD_RND);
 			break;
 		case Iop_DivF64:
-			mpfr_div(res->value, arg2tmpX, arg3tmpX, STD_RND);
+			mpfr_div(rd->value, arg2tmpX, arg3tmpX, STD_RND);
 			break;
 		default:
 			VG_(tool_panic)("Unhandled case in processTriOp");
 			break;
 	}
+	if (clo_checkPrecision > 0 && !exact) {
+		computeLane(op, checkLane(rd), &(arg2laneX), &(arg3laneX));
+	}
+
+	if (!exact) {
+		checkPromotion(addr, canceled, arg2origin, arg3origin);
+	}
 
 	mpfr_exp_t maxC = canceled;
 	Addr maxCorigin = addr;
@@ -1290,8 +3459,8 @@ static VG_REGPARM(2) void processTriOp(Addr addr, UWord ca) {
 		maxC = arg3canceled;
 		maxCorigin = arg3CancelOrigin;
 	}
-	res->canceled = maxC;
-	res->cancelOrigin = maxCorigin;
+	dataCold(rd)->canceled = maxC;
+	dataCold(rd)->cancelOrigin = maxCorigin;
 
 	if (clo_computeMeanValue) {
 		UInt cancellationBadness = 0;
@@ -1302,19 +3471,32 @@ static VG_REGPARM(2) void processTriOp(Addr addr, UWord ca) {
 			}
 		}
 
-		mpfr_set_d(meanOrg, triOpArgs->orgDouble, STD_RND);
-		updateMeanValue(addr, op, &(res->value), canceled, arg2origin, arg3origin, cancellationBadness);
+		if (exact) {
+			updateNativeMeanValue(addr, op, nativeRes, orgValue(op, orgBits),
+				canceled, arg2origin, arg3origin, cancellationBadness);
+		} else if (acc) {
+			updateAccMeanValue(addr, op, acc, accSample, orgValue(op, orgBits),
+				canceled, arg2origin, arg3origin, cancellationBadness);
+		} else if (inParts) {
+			updatePartsMeanValue(addr, op, dataParts(rd), orgValue(op, orgBits),
+				canceled, arg2origin, arg3origin, cancellationBadness);
+		} else {
+			mpfr_set_d(meanOrg, orgValue(op, orgBits), STD_RND);
+			updateMeanValue(addr, op, &(rd->value), canceled, arg2origin, arg3origin, cancellationBadness);
+			if (clo_checkPrecision > 0) {
+				checkLanes(addr, checkLane(rd));
+			}
+		}
 	}
 }
 
-static void instrumentTriOp(IRSB* sb, IRTypeEnv* env, Addr addr, IRTemp wrTemp, IRExpr* triop, Int arg2tmpInstead, Int arg3tmpInstead) {
+static void instrumentTriOp(IRSB* sb, IRTypeEnv* env, Addr addr, IRTemp wrTemp, IRExpr* triop, Int arg2tmpInstead, Int arg3tmpInstead, UInt lastUse) {
 	tl_assert(triop->tag == Iex_Triop);
 
 	if (clo_ignoreLibraries && isInLibrary(addr)) {
 		return;
 	}
 
-	IROp op = triop->Iex.Triop.op;
 	IRExpr* arg1 = triop->Iex.Triop.arg1;
 	IRExpr* arg2 = triop->Iex.Triop.arg2;
 	IRExpr* arg3 = triop->Iex.Triop.arg3;
@@ -1323,83 +3505,53 @@ static void instrumentTriOp(IRSB* sb, IRTypeEnv* env, Addr addr, IRTemp wrTemp,
 	tl_assert(arg2->tag == Iex_RdTmp || arg2->tag == Iex_Const);
 	tl_assert(arg3->tag == Iex_RdTmp || arg3->tag == Iex_Const);
 
-	Int constArgs = 0;
-
-	IRStmt* store = IRStmt_Store(Iend_LE, mkU64(&(triOpArgs->op)), mkU32(op));
-	addStmtToIRSB(sb, store);
-	store = IRStmt_Store(Iend_LE, mkU64(&(triOpArgs->wrTmp)), mkU32(wrTemp));
-	addStmtToIRSB(sb, store);
-
 	/* arg1 is ignored because it only contains the rounding mode for 
 	   the operations instructed at the moment */
-
-	if (arg2->tag == Iex_RdTmp) {
-		if (arg2tmpInstead >= 0) {
-			store = IRStmt_Store(Iend_LE, mkU64(&(triOpArgs->arg2)), mkU32(arg2tmpInstead));
-		} else {
-			store = IRStmt_Store(Iend_LE, mkU64(&(triOpArgs->arg2)), mkU32(triop->Iex.Triop.arg2->Iex.RdTmp.tmp));
-		}
-		addStmtToIRSB(sb, store);
-		writeSTemp(sb, env, triop->Iex.Triop.arg2->Iex.RdTmp.tmp, 1);
-	} else {
-		tl_assert(arg2->tag == Iex_Const);
-		writeSConst(sb, arg2->Iex.Const.con, 1);
-		constArgs |= 0x2;
-	}
-
-	if (arg3->tag == Iex_RdTmp) {
-		if (arg3tmpInstead >= 0) {
-			store = IRStmt_Store(Iend_LE, mkU64(&(triOpArgs->arg3)), mkU32(arg3tmpInstead));
-		} else {
-			store = IRStmt_Store(Iend_LE, mkU64(&(triOpArgs->arg3)), mkU32(triop->Iex.Triop.arg3->Iex.RdTmp.tmp));
-		}
-		addStmtToIRSB(sb, store);
-		writeSTemp(sb, env, triop->Iex.Triop.arg3->Iex.RdTmp.tmp, 2);
-	} else {
-		tl_assert(arg3->tag == Iex_Const);
-		writeSConst(sb, arg3->Iex.Const.con, 2);
-		constArgs |= 0x4;
-	}
-
-	store = IRStmt_Store(Iend_LE, mkU64(&(triOpArgs->orgDouble)), IRExpr_RdTmp(wrTemp));
-	addStmtToIRSB(sb, store);
-
-	IRExpr** argv = mkIRExprVec_2(mkU64(addr), mkU64(constArgs));
-	IRDirty* di = unsafeIRDirty_0_N(2, "processTriOp", VG_(fnptr_to_fnentry)(&processTriOp), argv);
+	OpDesc desc;
+	initOpDesc(&desc, addr, triop->Iex.Triop.op, wrTemp);
+	setDescArg(&desc, env, arg2, 1, arg2tmpInstead);
+	setDescArg(&desc, env, arg3, 2, arg3tmpInstead);
+	desc.lastUse = lastUse;
+
+	IRExpr** argv = mkIRExprVec_4(mkU64((Addr)internOpDesc(&desc)), tempBits(sb, env, arg2),
+		tempBits(sb, env, arg3), tempBits(sb, env, IRExpr_RdTmp(wrTemp)));
+	IRDirty* di = unsafeIRDirty_0_N(3, "processTriOp", VG_(fnptr_to_fnentry)(&processTriOp), argv);
 	addStmtToIRSB(sb, IRStmt_Dirty(di));
 }
 
-static VG_REGPARM(1) void processMux0X(UWord ca) {
+/* expr0 and exprX are -1 for constants */
+static VG_REGPARM(3) void processMux0X(UWord wrTmp, UWord e0, UWord eX, UWord condVal) {
 	if (!clo_analyze) return;
 
-	Int constArgs = (Int)ca;
+	Int expr0 = (Int)e0;
+	Int exprX = (Int)eX;
 	ShadowValue *aexpr0 = NULL;
 	ShadowValue *aexprX = NULL;
 
-	if (constArgs & 0x2) {
-		if (!muxArgs->condVal) {
+	if (expr0 < 0) {
+		if (!condVal) {
 			return;
 		}
 	} else {
-		aexpr0 = getTemp(muxArgs->expr0);
-		if (!aexpr0 && !muxArgs->condVal) {
+		aexpr0 = getTemp(expr0);
+		if (!aexpr0 && !condVal) {
 			return;
 		}
 	}
 
-	if (constArgs & 0x4) {
-		if (muxArgs->condVal) {
+	if (exprX < 0) {
+		if (condVal) {
 			return;
 		}
 	} else {
-		aexprX = getTemp(muxArgs->exprX);
-		if (!aexprX && muxArgs->condVal) {
+		aexprX = getTemp(exprX);
+		if (!aexprX && condVal) {
 			return;
 		}
 	}
 
-	ShadowValue* res = setTemp(muxArgs->wrTmp);
-	if (muxArgs->condVal) {
+	ShadowValue* res = setTemp((IRTemp)wrTmp);
+	if (condVal) {
 		copyShadowValue(res, aexprX);
 	} else {
 		copyShadowValue(res, aexpr0);
@@ -1417,36 +3569,32 @@ static void instrumentMux0X(IRSB* sb, IRTypeEnv* env, IRTemp wrTemp, IRExpr* mux
 	tl_assert(expr0->tag == Iex_RdTmp || expr0->tag == Iex_Const);
 	tl_assert(exprX->tag == Iex_RdTmp || exprX->tag == Iex_Const);
 
-	Int constArgs = 0;
-	IRStmt* store = IRStmt_Store(Iend_LE, mkU64(&(muxArgs->wrTmp)), mkU32(wrTemp));
-	addStmtToIRSB(sb, store);
-	store = IRStmt_Store(Iend_LE, mkU64(&(muxArgs->condVal)), mux->Iex.Mux0X.cond);
-	addStmtToIRSB(sb, store);
-
+	Int tmp0 = -1;
+	Int tmpX = -1;
 	if (expr0->tag == Iex_RdTmp) {
-		if (arg0tmpInstead >= 0) {
-			store = IRStmt_Store(Iend_LE, mkU64(&(muxArgs->expr0)), mkU32(arg0tmpInstead));
-		} else {
-			store = IRStmt_Store(Iend_LE, mkU64(&(muxArgs->expr0)), mkU32(mux->Iex.Mux0X.expr0->Iex.RdTmp.tmp));
-		}
-		addStmtToIRSB(sb, store);
-	} else {
-		constArgs |= 0x2;
+		tmp0 = arg0tmpInstead >= 0 ? arg0tmpInstead : expr0->Iex.RdTmp.tmp;
 	}
-
 	if (exprX->tag == Iex_RdTmp) {
-		if (argXtmpInstead >= 0) {
-			store = IRStmt_Store(Iend_LE, mkU64(&(muxArgs->exprX)), mkU32(argXtmpInstead));
-		} else {
-			store = IRStmt_Store(Iend_LE, mkU64(&(muxArgs->exprX)), mkU32(mux->Iex.Mux0X.exprX->Iex.RdTmp.tmp));
-		}
-		addStmtToIRSB(sb, store);
+		tmpX = argXtmpInstead >= 0 ? argXtmpInstead : exprX->Iex.RdTmp.tmp;
+	}
+
+	/* the result of two constants has no shadow value */
+	if (tmp0 < 0 && tmpX < 0) {
+		return;
+	}
+	IRTemp guard;
+	if (tmp0 < 0) {
+		guard = tempGuard(sb, tmpX);
+	} else if (tmpX < 0) {
+		guard = tempGuard(sb, tmp0);
 	} else {
-		constArgs |= 0x4;
+		guard = orGuards(sb, tempGuard(sb, tmp0), tempGuard(sb, tmpX));
 	}
 
-	IRExpr** argv = mkIRExprVec_1(mkU64(constArgs));
-	IRDirty* di = unsafeIRDirty_0_N(1, "processMux0X", VG_(fnptr_to_fnentry)(&processMux0X), argv);
+	IRTemp condVal = assignNew(sb, Ity_I64, IRExpr_Unop(Iop_8Uto64, cond));
+	IRExpr** argv = mkIRExprVec_4(mkU64(wrTemp), mkU64(tmp0), mkU64(tmpX), IRExpr_RdTmp(condVal));
+	IRDirty* di = unsafeIRDirty_0_N(3, "processMux0X", VG_(fnptr_to_fnentry)(&processMux0X), argv);
+	di->guard = IRExpr_RdTmp(guard);
 	addStmtToIRSB(sb, IRStmt_Dirty(di));
 }
 
@@ -1454,14 +3602,32 @@ static VG_REGPARM(2) void processLoad(UWord tmp, Addr addr) {
 	if (!clo_analyze) return;
 
 	/* check if this memory address is shadowed */
-	ShadowValue* av = VG_(HT_lookup)(globalMemory, addr);
+	ShadowValue* av = getShadowMem(addr);
 	if (!av || !(av->active)) {
 		return;
 	}
+	av->referenced = True;
 	ShadowValue* res = setTemp(tmp);
 	copyShadowValue(res, av);
 }
 
+/* Types of loads and stores that can move a floating-point value, I32 and
+   I64 are needed because VEX moves the lanes of SSE registers as integers.
+   Narrower stores only drop the shadow value. */
+static __inline__
+Bool isShadowedType(IRType type) {
+	switch (type) {
+		case Ity_I32:
+		case Ity_I64:
+		case Ity_F32:
+		case Ity_F64:
+		case Ity_V128:
+			return True;
+		default:
+			return False;
+	}
+}
+
 static void instrumentLoad(IRSB* sb, IRTypeEnv* env, IRStmt* wrTmp) {
 	tl_assert(wrTmp->tag == Ist_WrTmp);
 	tl_assert(wrTmp->Ist.WrTmp.data->tag == Iex_Load);
@@ -1471,15 +3637,19 @@ static void instrumentLoad(IRSB* sb, IRTypeEnv* env, IRStmt* wrTmp) {
 		return;
 	}
 	
+	/* the helper is only called if the memory may have a shadow value */
+	IRTemp guard = shadowMemGuard(sb, load->Iex.Load.addr);
 	IRExpr** argv = mkIRExprVec_2(mkU64(wrTmp->Ist.WrTmp.tmp), load->Iex.Load.addr);
 	IRDirty* di = unsafeIRDirty_0_N(2, "processLoad", VG_(fnptr_to_fnentry)(&processLoad), argv);
+	di->guard = IRExpr_RdTmp(guard);
 	addStmtToIRSB(sb, IRStmt_Dirty(di));
 }
 
-static VG_REGPARM(3) void processStore(Addr addr, UWord t, UWord isFloat) {
+/* orgBits is the stored value, see tempBits */
+static VG_REGPARM(3) void processStore(Addr addr, UWord t, UWord isFloat, ULong orgBits) {
 	Int tmp = (Int)t;
 	ShadowValue* res = NULL;
-	ShadowValue* currentVal = VG_(HT_lookup)(globalMemory, addr);
+	ShadowValue* currentVal = getShadowMem(addr);
 
 	if (clo_analyze && tmp >= 0) {
 		/* check if this memory address is shadowed */
@@ -1490,26 +3660,32 @@ static VG_REGPARM(3) void processStore(Addr addr, UWord t, UWord isFloat) {
 				copyShadowValue(res, av);
 				res->active = True;
 			} else {
+				if (clo_max_shadow_mb > 0 && shadowBytes >= shadowLimit()) {
+					reclaimShadowMem();
+				}
 				res = initShadowValue((UWord)addr);
 				copyShadowValue(res, av);
-				VG_(HT_add_node)(globalMemory, res);
+				setShadowMem(addr, res);
 			}
+			res->referenced = True;
 
+			ShadowValueCold* cold = svCold(res);
 			if ((Bool)isFloat) {
-				res->orgType = Ot_FLOAT;
+				cold->orgType = Ot_FLOAT;
 			} else {
-				res->orgType = Ot_DOUBLE;
+				cold->orgType = Ot_DOUBLE;
 			}
-			if (res->orgType == Ot_FLOAT) {
-				res->Org.fl = storeArgs->orgFloat;
-			} else if (res->orgType == Ot_DOUBLE) {
-				res->Org.db = storeArgs->orgDouble;
+			if (cold->orgType == Ot_FLOAT) {
+				UInt lo = (UInt)orgBits;
+				cold->Org.fl = *(Float*)&lo;
+			} else if (cold->orgType == Ot_DOUBLE) {
+				cold->Org.db = *(Double*)&orgBits;
 			} else {
 				tl_assert(False);
 			}
 	
 			if (activeStages > 0) {
-				updateStages(addr, res->orgType == Ot_FLOAT);
+				updateStages(addr, cold->orgType == Ot_FLOAT);
 			}
 		}
 	}
@@ -1519,13 +3695,31 @@ static VG_REGPARM(3) void processStore(Addr addr, UWord t, UWord isFloat) {
 	}
 }
 
+/* A store of a block without floating-point data only drops the shadow value. */
+static VG_REGPARM(1) void processStoreNone(Addr addr) {
+	ShadowValue* currentVal = getShadowMem(addr);
+	if (currentVal) {
+		currentVal->active = False;
+	}
+}
+
+static void instrumentStoreNone(IRSB* sb, IRStmt* store) {
+	tl_assert(store->tag == Ist_Store);
+
+	IRTemp guard = shadowMemGuard(sb, store->Ist.Store.addr);
+	IRExpr** argv = mkIRExprVec_1(store->Ist.Store.addr);
+	IRDirty* di = unsafeIRDirty_0_N(1, "processStoreNone", VG_(fnptr_to_fnentry)(&processStoreNone), argv);
+	di->guard = IRExpr_RdTmp(guard);
+	addStmtToIRSB(sb, IRStmt_Dirty(di));
+}
+
 static void instrumentStore(IRSB* sb, IRTypeEnv* env, IRStmt* store, Int argTmpInstead) {
 	tl_assert(store->tag == Ist_Store);
 
 	Bool isFloat = True;
 	IRExpr* data = store->Ist.Store.data;
 	if (data->tag == Iex_RdTmp) {
-		/* I32 and I64 have to be instrumented due to SSE */
+		/* I32 and I64 have to be instrumented due to SSE, see isShadowedType */
 		switch (typeOfIRTemp(env, data->Iex.RdTmp.tmp)) {
 			case Ity_I64:
 			case Ity_F64:
@@ -1542,70 +3736,100 @@ static void instrumentStore(IRSB* sb, IRTypeEnv* env, IRStmt* store, Int argTmpI
 	tl_assert(data->tag == Iex_RdTmp || data->tag == Iex_Const);
 
 	Int num = -1;
-	IRType type = Ity_F32;
 	if (data->tag != Iex_Const) {
 		if (argTmpInstead >= 0) {
 			num = argTmpInstead;
 		} else {
 			num = data->Iex.RdTmp.tmp;
 		}
-		type = typeOfIRTemp(env, num);
-
-		if (isFloat) {
-			IRStmt* store = IRStmt_Store(Iend_LE, mkU64(&(storeArgs->orgFloat)), IRExpr_RdTmp(data->Iex.RdTmp.tmp));
-			addStmtToIRSB(sb, store);
-		} else {
-			IRStmt* store = IRStmt_Store(Iend_LE, mkU64(&(storeArgs->orgDouble)), IRExpr_RdTmp(data->Iex.RdTmp.tmp));
-			addStmtToIRSB(sb, store);
-		}
 	}
 	
-	IRExpr** argv = mkIRExprVec_3(addr, mkU64(num), mkU64(isFloat));
+	/* nothing to do if neither the value nor the memory has a shadow value */
+	IRTemp guard = shadowMemGuard(sb, addr);
+	if (num >= 0) {
+		guard = orGuards(sb, tempGuard(sb, num), guard);
+	}
+	IRExpr** argv = mkIRExprVec_4(addr, mkU64(num), mkU64(isFloat), tempBits(sb, env, data));
 	IRDirty* di = unsafeIRDirty_0_N(3, "processStore", VG_(fnptr_to_fnentry)(&processStore), argv);
+	di->guard = IRExpr_RdTmp(guard);
 	addStmtToIRSB(sb, IRStmt_Dirty(di));
 }
 
-static VG_REGPARM(2) void processPut(UWord offset, UWord t) {
-	ShadowValue* res = NULL;
-	ThreadId tid = VG_(get_running_tid)();
-	ShadowValue* currentVal = threadRegisters[tid][offset];
+/* The shadow values of the registers are kept in the first shadow area of
+   the guest state, like the V bits of Memcheck. The shadow of the register
+   at offset is a 32-bit handle of its shadow data at offset + total_sizeB,
+   thus 4-byte registers get slots of their own. 0 means no shadow value.
+   Every slot holds a reference of its data. Narrower or unaligned registers
+   never hold floating-point values and are not shadowed. */
+static __inline__
+UInt dataHandle(ShadowData* d) {
+	return d->cold + 1;
+}
 
+static __inline__
+ShadowData* handleData(UWord h) {
+	tl_assert(h > 0 && h <= dataColdArray.used);
+	return ((ShadowDataCold*)dataColdArray.elems)[h - 1].data;
+}
+
+/* Returns the new slot of a register that is overwritten by tmp. */
+static VG_REGPARM(2) UWord processPut(UWord h, UWord t) {
 	Int tmp = (Int)t;
+	UWord res = 0;
+
 	if (clo_analyze && tmp >= 0) {
 		/* check if a shadow value exits */
 		ShadowValue* av = getTemp(tmp);
 		if (av) {
-			if (currentVal) {
-				/* reuse allocated space if possible ... */
-				res = currentVal;
-				copyShadowValue(res, av);
-			} else {
-				/* ... else allocate new space */
-				res = initShadowValue((UWord)offset);
-				copyShadowValue(res, av);
-				threadRegisters[tid][offset] = res;
-			}
-			res->active = True;
+			av->data->refCount++;
+			sharedCopies++;
+			res = dataHandle(av->data);
 		}
 	}
 
-	if (currentVal && !res) {
-		/* Invalidate existing shadow value (not free) because 
-           something was stored in this register */
-		currentVal->active = False;
+	/* the old shadow value is dropped, even if nothing is stored */
+	if (h != 0) {
+		releaseShadowData(handleData(h));
 	}
+	return res;
 }
 
-static void instrumentPut(IRSB* sb, IRTypeEnv* env, IRStmt* st, Int argTmpInstead) {
+static VG_REGPARM(1) void processPutNone(UWord h) {
+	releaseShadowData(handleData(h));
+}
+
+static VG_REGPARM(2) void processGet(UWord h, UWord tmp) {
+	if (!clo_analyze) return;
+
+	ShadowValue* res = setTemp((Int)tmp);
+	setShadowData(res, handleData(h));
+}
+
+/* Calls processPutNone if the slot in old holds a shadow value, the
+   register gets no new one. */
+static void dropRegShadow(IRSB* sb, IRTemp old) {
+	IRTemp guard = assignNew(sb, Ity_I1, IRExpr_Binop(Iop_CmpNE32, IRExpr_RdTmp(old), mkU32(0)));
+	IRTemp h = assignNew(sb, Ity_I64, IRExpr_Unop(Iop_32Uto64, IRExpr_RdTmp(old)));
+
+	IRExpr** argv = mkIRExprVec_1(IRExpr_RdTmp(h));
+	IRDirty* di = unsafeIRDirty_0_N(1, "processPutNone", VG_(fnptr_to_fnentry)(&processPutNone), argv);
+	di->guard = IRExpr_RdTmp(guard);
+	addStmtToIRSB(sb, IRStmt_Dirty(di));
+}
+
+static void instrumentPut(IRSB* sb, IRTypeEnv* env, IRStmt* st, Int argTmpInstead, VexGuestLayout* layout) {
 	tl_assert(st->tag == Ist_Put);
 	IRExpr* data = st->Ist.Put.data;
 	tl_assert(data->tag == Iex_RdTmp || data->tag == Iex_Const);
 
 	Int offset = st->Ist.Put.offset;
-	tl_assert(offset >= 0 && offset < MAX_REGISTERS);
+	if (offset % 4 != 0) {
+		return;
+	}
+	Int slot = offset + layout->total_sizeB;
 
 	Int tmpNum = -1;
-	if (data->tag == Iex_RdTmp) {
+	if (data->tag == Iex_RdTmp && sizeofIRType(typeOfIRExpr(env, data)) >= 4) {
 		if (argTmpInstead >= 0) {
 			tmpNum = argTmpInstead;
 		} else {
@@ -1613,81 +3837,73 @@ static void instrumentPut(IRSB* sb, IRTypeEnv* env, IRStmt* st, Int argTmpInstea
 		}
 	}
 
-	IRExpr** argv = mkIRExprVec_2(mkU64(offset), mkU64(tmpNum));
-	IRDirty* di = unsafeIRDirty_0_N(2, "processPut", VG_(fnptr_to_fnentry)(&processPut), argv);
-	addStmtToIRSB(sb, IRStmt_Dirty(di));
+	IRTemp old = assignNew(sb, Ity_I32, IRExpr_Get(slot, Ity_I32));
+	if (tmpNum >= 0) {
+		IRTemp oldW = assignNew(sb, Ity_I64, IRExpr_Unop(Iop_32Uto64, IRExpr_RdTmp(old)));
+		IRTemp h = newIRTemp(sb->tyenv, Ity_I64);
+		IRExpr** argv = mkIRExprVec_2(IRExpr_RdTmp(oldW), mkU64(tmpNum));
+		IRDirty* di = unsafeIRDirty_1_N(h, 2, "processPut", VG_(fnptr_to_fnentry)(&processPut), argv);
+		addStmtToIRSB(sb, IRStmt_Dirty(di));
+		IRTemp h32 = assignNew(sb, Ity_I32, IRExpr_Unop(Iop_64to32, IRExpr_RdTmp(h)));
+		addStmtToIRSB(sb, IRStmt_Put(slot, IRExpr_RdTmp(h32)));
+	} else {
+		/* a constant or an integer narrower than a float is stored */
+		dropRegShadow(sb, old);
+		addStmtToIRSB(sb, IRStmt_Put(slot, mkU32(0)));
+	}
 }
 
-static VG_REGPARM(2) void processGet(UWord offset, UWord tmp) {
-	if (!clo_analyze) return;
+/* A register written by a block without floating-point data loses its
+   shadow value. */
+static void instrumentPutNone(IRSB* sb, IRStmt* st, VexGuestLayout* layout) {
+	tl_assert(st->tag == Ist_Put);
 
-	ThreadId tid = VG_(get_running_tid)();
-	ShadowValue* av = threadRegisters[tid][offset];
-	if (!av || !(av->active)) {
+	Int offset = st->Ist.Put.offset;
+	if (offset % 4 != 0) {
 		return;
 	}
+	Int slot = offset + layout->total_sizeB;
 
-	ShadowValue* res = setTemp((Int)tmp);
-	copyShadowValue(res, av);
+	IRTemp old = assignNew(sb, Ity_I32, IRExpr_Get(slot, Ity_I32));
+	dropRegShadow(sb, old);
+	addStmtToIRSB(sb, IRStmt_Put(slot, mkU32(0)));
 }
 
-static void instrumentGet(IRSB* sb, IRTypeEnv* env, IRStmt* st) {
+static void instrumentGet(IRSB* sb, IRTypeEnv* env, IRStmt* st, VexGuestLayout* layout) {
 	tl_assert(st->tag == Ist_WrTmp);
 	tl_assert(st->Ist.WrTmp.data->tag == Iex_Get);
 
 	Int tmpNum = st->Ist.WrTmp.tmp;
 	Int offset = st->Ist.WrTmp.data->Iex.Get.offset;
-	tl_assert(offset >= 0 && offset < MAX_REGISTERS);
+	if (offset % 4 != 0 || sizeofIRType(st->Ist.WrTmp.data->Iex.Get.ty) < 4) {
+		return;
+	}
+
+	/* the helper is only called if the register has a shadow value */
+	IRTemp h = assignNew(sb, Ity_I32, IRExpr_Get(offset + layout->total_sizeB, Ity_I32));
+	IRTemp guard = assignNew(sb, Ity_I1, IRExpr_Binop(Iop_CmpNE32, IRExpr_RdTmp(h), mkU32(0)));
+	IRTemp hW = assignNew(sb, Ity_I64, IRExpr_Unop(Iop_32Uto64, IRExpr_RdTmp(h)));
 
-	IRExpr** argv = mkIRExprVec_2(mkU64(offset), mkU64(tmpNum));
+	IRExpr** argv = mkIRExprVec_2(IRExpr_RdTmp(hW), mkU64(tmpNum));
 	IRDirty* di = unsafeIRDirty_0_N(2, "processGet", VG_(fnptr_to_fnentry)(&processGet), argv);
+	di->guard = IRExpr_RdTmp(guard);
 	addStmtToIRSB(sb, IRStmt_Dirty(di));
 }
 
-static VG_REGPARM(3) void processPutI(UWord t, UWord b, UWord n) {
-	Int tmp = (Int)t;
-	Int nElems = (Int)n;
-	Int base = (Int)b;
-	Int bias = (Int)(circRegs->bias);
-
-	/* (ix + bias) % num-of-elems-in-the-array */
-	Int offset = base + ((circRegs->ix + bias) % nElems);
-	tl_assert(offset >= 0 && offset < MAX_REGISTERS);
-
-	ShadowValue* res = NULL;
-	ThreadId tid = VG_(get_running_tid)();
-	ShadowValue* currentVal = threadRegisters[tid][offset];
-
-	if (clo_analyze && tmp >= 0) {
-		/* check if a shadow value exits */
-		ShadowValue* av = getTemp(tmp);
-		if (av) {
-			if (currentVal) {
-				/* reuse allocated space if possible ... */
-				res = currentVal;
-				copyShadowValue(res, av);
-			} else {
-				/* ... else allocate new space */
-				res = initShadowValue((UWord)offset);
-				copyShadowValue(res, av);
-				threadRegisters[tid][offset] = res;
-			}
-			res->active = True;
-		}
-	}
-
-	if (currentVal && !res) {
-		/* Invalidate existing shadow value (not free) because 
-           something was stored in this register. */
-		currentVal->active = False;
+/* The shadow of a register array (the x87 registers) is an array of 64-bit
+   slots, the handle is in the lower half like for plain registers. The
+   circular indexing is done by VEX as for the original array. */
+static IRRegArray* shadowRegArray(IRRegArray* descr, VexGuestLayout* layout) {
+	if (sizeofIRType(descr->elemTy) != 8) {
+		return NULL;
 	}
+	return mkIRRegArray(descr->base + layout->total_sizeB, Ity_I64, descr->nElems);
 }
 
-static void instrumentPutI(IRSB* sb, IRTypeEnv* env, IRStmt* st, Int argTmpInstead) {
+static void instrumentPutI(IRSB* sb, IRTypeEnv* env, IRStmt* st, Int argTmpInstead, VexGuestLayout* layout) {
 	tl_assert(st->tag == Ist_PutI);
 	IRExpr* data = st->Ist.PutI.data;
 	IRExpr* ix = st->Ist.PutI.ix;
-	IRRegArray* descr = st->Ist.PutI.descr;
 	Int bias = st->Ist.PutI.bias;
 
 	tl_assert(data->tag == Iex_RdTmp || data->tag == Iex_Const);
@@ -1696,6 +3912,11 @@ static void instrumentPutI(IRSB* sb, IRTypeEnv* env, IRStmt* st, Int argTmpInste
 	tl_assert(ix->tag == Iex_RdTmp ? typeOfIRTemp(env, ix->Iex.RdTmp.tmp) == Ity_I32 : True);
 	tl_assert(ix->tag == Iex_Const ? ix->Iex.Const.con->tag == Ico_U32 : True);
 
+	IRRegArray* descr = shadowRegArray(st->Ist.PutI.descr, layout);
+	if (!descr) {
+		return;
+	}
+
 	Int tmpNum = -1;
 	if (data->tag == Iex_RdTmp) {
 		if (argTmpInstead >= 0) {
@@ -1705,78 +3926,279 @@ static void instrumentPutI(IRSB* sb, IRTypeEnv* env, IRStmt* st, Int argTmpInste
 		}
 	}
 
-	IRStmt* store = IRStmt_Store(Iend_LE, mkU64(&(circRegs->bias)), mkU64(bias));
-	addStmtToIRSB(sb, store);
-	store = IRStmt_Store(Iend_LE, mkU64(&(circRegs->ix)), ix);
-	addStmtToIRSB(sb, store);
-
-	IRExpr** argv = mkIRExprVec_3(mkU64(tmpNum), mkU64(descr->base), mkU64(descr->nElems));
-	IRDirty* di = unsafeIRDirty_0_N(3, "processPutI", VG_(fnptr_to_fnentry)(&processPutI), argv);
-	addStmtToIRSB(sb, IRStmt_Dirty(di));
-}
-
-static VG_REGPARM(3) void processGetI(UWord tmp, UWord b, UWord n) {
-	if (!clo_analyze) return;
-
-	Int nElems = (Int)n;
-	Int base = (Int)b;
-	Int bias = (Int)(circRegs->bias);
-
-	/* (ix + bias) % num-of-elems-in-the-array */
-	Int offset = base + ((circRegs->ix + bias) % nElems);
-	tl_assert(offset >= 0 && offset < MAX_REGISTERS);
-
-	ThreadId tid = VG_(get_running_tid)();
-	ShadowValue* av = threadRegisters[tid][offset];
-	if (!av || !(av->active)) {
-		return;
+	/* the upper half is zero unless a plain Put wrote it */
+	IRTemp old = assignNew(sb, Ity_I32, IRExpr_Unop(Iop_64to32, IRExpr_GetI(descr, ix, bias)));
+	if (tmpNum >= 0) {
+		IRTemp oldW = assignNew(sb, Ity_I64, IRExpr_Unop(Iop_32Uto64, IRExpr_RdTmp(old)));
+		IRTemp h = newIRTemp(sb->tyenv, Ity_I64);
+		IRExpr** argv = mkIRExprVec_2(IRExpr_RdTmp(oldW), mkU64(tmpNum));
+		IRDirty* di = unsafeIRDirty_1_N(h, 2, "processPut", VG_(fnptr_to_fnentry)(&processPut), argv);
+		addStmtToIRSB(sb, IRStmt_Dirty(di));
+		addStmtToIRSB(sb, IRStmt_PutI(descr, ix, bias, IRExpr_RdTmp(h)));
+	} else {
+		dropRegShadow(sb, old);
+		addStmtToIRSB(sb, IRStmt_PutI(descr, ix, bias, mkU64(0)));
 	}
-
-	ShadowValue* res = setTemp((Int)tmp);
-	copyShadowValue(res, av);
 }
 
-static void instrumentGetI(IRSB* sb, IRTypeEnv* env, IRStmt* st) {
+static void instrumentGetI(IRSB* sb, IRTypeEnv* env, IRStmt* st, VexGuestLayout* layout) {
 	tl_assert(st->tag == Ist_WrTmp);
 	tl_assert(st->Ist.WrTmp.data->tag == Iex_GetI);
 	IRExpr* get = st->Ist.WrTmp.data;
 
 	IRExpr* ix = get->Iex.GetI.ix;
-	IRRegArray* descr = get->Iex.GetI.descr;
 	Int bias = get->Iex.GetI.bias;
 
 	tl_assert(ix->tag == Iex_RdTmp || ix->tag == Iex_Const);
 	tl_assert(ix->tag == Iex_RdTmp ? typeOfIRTemp(env, ix->Iex.RdTmp.tmp) == Ity_I32 : True);
 	tl_assert(ix->tag == Iex_Const ? ix->Iex.Const.con->tag == Ico_U32 : True);
 
+	IRRegArray* descr = shadowRegArray(get->Iex.GetI.descr, layout);
+	if (!descr) {
+		return;
+	}
+
 	Int tmpNum = st->Ist.WrTmp.tmp;
 
-	IRStmt* store = IRStmt_Store(Iend_LE, mkU64(&(circRegs->bias)), mkU64(bias));
-	addStmtToIRSB(sb, store);
-	store = IRStmt_Store(Iend_LE, mkU64(&(circRegs->ix)), ix);
-	addStmtToIRSB(sb, store);
+	IRTemp h32 = assignNew(sb, Ity_I32, IRExpr_Unop(Iop_64to32, IRExpr_GetI(descr, ix, bias)));
+	IRTemp guard = assignNew(sb, Ity_I1, IRExpr_Binop(Iop_CmpNE32, IRExpr_RdTmp(h32), mkU32(0)));
+	IRTemp h = assignNew(sb, Ity_I64, IRExpr_Unop(Iop_32Uto64, IRExpr_RdTmp(h32)));
 
-	IRExpr** argv = mkIRExprVec_3(mkU64(tmpNum), mkU64(descr->base), mkU64(descr->nElems));
-	IRDirty* di = unsafeIRDirty_0_N(3, "processGetI", VG_(fnptr_to_fnentry)(&processGetI), argv);
+	IRExpr** argv = mkIRExprVec_2(IRExpr_RdTmp(h), mkU64(tmpNum));
+	IRDirty* di = unsafeIRDirty_0_N(2, "processGet", VG_(fnptr_to_fnentry)(&processGet), argv);
+	di->guard = IRExpr_RdTmp(guard);
 	addStmtToIRSB(sb, IRStmt_Dirty(di));
 }
 
-static void instrumentEnterSB(IRSB* sb) {
-	/* inlining of sbExecuted++ */
-	IRExpr* load = IRExpr_Load(Iend_LE, Ity_I64, mkU64(&sbExecuted));
-	IRTemp t1 = newIRTemp(sb->tyenv, Ity_I64);
-  	addStmtToIRSB(sb, IRStmt_WrTmp(t1, load));
-	IRExpr* add = IRExpr_Binop(Iop_Add64, IRExpr_RdTmp(t1), mkU64(1));
-  	IRTemp t2 = newIRTemp(sb->tyenv, Ity_I64);
-  	addStmtToIRSB(sb, IRStmt_WrTmp(t2, add));
-	IRStmt* store = IRStmt_Store(Iend_LE, mkU64(&sbExecuted), IRExpr_RdTmp(t2));
-	addStmtToIRSB(sb, store);
+/* The slots of all registers of a thread, read and written as a whole. */
+static UInt regSlots[sizeof(VexGuestArchState) / sizeof(UInt)];
+
+static void dropRegShadows(ThreadId tid, Bool release) {
+	Int i;
+	VG_(get_shadow_regs_area)(tid, (UChar*)regSlots, 1, 0, sizeof(regSlots));
+	for (i = 0; i < sizeof(regSlots) / sizeof(UInt); i++) {
+		if (regSlots[i] != 0) {
+			if (release) {
+				releaseShadowData(handleData(regSlots[i]));
+			}
+			regSlots[i] = 0;
+		}
+	}
+	VG_(set_shadow_regs_area)(tid, 1, 0, sizeof(regSlots), (UChar*)regSlots);
+}
+
+/* The guest state of a new thread is a copy of the one of its parent, with
+   slots that hold no references. They are cleared before the thread runs. */
+static void threadFirstInsn(ThreadId tid) {
+	dropRegShadows(tid, False);
+}
+
+static void threadExit(ThreadId tid) {
+	dropRegShadows(tid, True);
+}
+
+/* The signal frame keeps a copy of the shadow guest state, which is restored
+   when the handler returns, so it needs references of its own. If the handler
+   does not return, they are never released. */
+static void preDeliverSignal(ThreadId tid, Int sigNo, Bool altStack) {
+	Int i;
+	VG_(get_shadow_regs_area)(tid, (UChar*)regSlots, 1, 0, sizeof(regSlots));
+	for (i = 0; i < sizeof(regSlots) / sizeof(UInt); i++) {
+		if (regSlots[i] != 0) {
+			handleData(regSlots[i])->refCount++;
+		}
+	}
+}
+
+static void instrumentEnterSB(IRSB* sb) {
+	/* inlining of sbExecuted++ */
+	IRExpr* load = IRExpr_Load(Iend_LE, Ity_I64, mkU64(&sbExecuted));
+	IRTemp t1 = newIRTemp(sb->tyenv, Ity_I64);
+  	addStmtToIRSB(sb, IRStmt_WrTmp(t1, load));
+	IRExpr* add = IRExpr_Binop(Iop_Add64, IRExpr_RdTmp(t1), mkU64(1));
+  	IRTemp t2 = newIRTemp(sb->tyenv, Ity_I64);
+  	addStmtToIRSB(sb, IRStmt_WrTmp(t2, add));
+	IRStmt* store = IRStmt_Store(Iend_LE, mkU64(&sbExecuted), IRExpr_RdTmp(t2));
+	addStmtToIRSB(sb, store);
+}
+
+static void reportUnsupportedOp(IROp op) {
+	if (!VG_(OSetWord_Contains)(unsupportedOps, (UWord)op)) {
+		VG_(OSetWord_Insert)(unsupportedOps, (UWord)op);
+	}
+}
+
+/* Registers that hold floating-point values even if VEX reads and writes
+   them as integers, which it does for the lanes of the SSE registers.
+   On other architectures all registers are counted. */
+#if defined(VGA_amd64)
+#define FP_REGS_START						offsetof(VexGuestAMD64State, guest_XMM0)
+#define FP_REGS_END							(offsetof(VexGuestAMD64State, guest_XMM15) + (Int)sizeof(U128))
+#elif defined(VGA_x86)
+#define FP_REGS_START						offsetof(VexGuestX86State, guest_XMM0)
+#define FP_REGS_END							(offsetof(VexGuestX86State, guest_XMM7) + (Int)sizeof(U128))
+#else
+#define FP_REGS_START						0
+#define FP_REGS_END							((Int)sizeof(VexGuestArchState))
+#endif
+
+static __inline__
+Bool isFpReg(Int offset, IRType type) {
+	return offset < FP_REGS_END && offset + sizeofIRType(type) > FP_REGS_START;
+}
+
+static __inline__
+Bool isFpType(IRType type) {
+	return type == Ity_F32 || type == Ity_F64 || type == Ity_F128 || type == Ity_V128;
+}
+
+/* the operations that get a call of processUnOp, processBinOp or processTriOp */
+static Bool isShadowedOp(IROp op) {
+	switch (op) {
+		SHADOWED_UNOPS(SHADOWED_CASE)
+		SHADOWED_BINOPS(SHADOWED_CASE)
+		SHADOWED_TRIOPS(SHADOWED_CASE)
+			return True;
+		default:
+			return False;
+	}
+}
+
+/* Scans the statements of a superblock, starting at first, for its
+   floating-point work. Only Bk_FP blocks get the full instrumentation.
+   Bk_MOVE blocks only propagate the shadow values of the temporaries that
+   are stored, put or selected by Mux0X, Bk_INT blocks only drop the shadow values of what
+   they overwrite. A double that is copied with integer registers loses
+   its shadow value then. */
+static BlockKind classifySB(IRSB* sb, Int first) {
+	BlockKind kind = Bk_INT;
+	IRExpr* expr;
+	Int i;
+
+	for (i = first; i < sb->stmts_used; i++) {
+		IRStmt* st = sb->stmts[i];
+		if (!st) continue;
+
+		switch (st->tag) {
+			case Ist_Put:
+				if (isFpReg(st->Ist.Put.offset, typeOfIRExpr(sb->tyenv, st->Ist.Put.data))) {
+					kind = Bk_MOVE;
+				}
+				break;
+			case Ist_PutI:
+				kind = Bk_MOVE;
+				break;
+			case Ist_WrTmp:
+				if (isFpType(typeOfIRTemp(sb->tyenv, st->Ist.WrTmp.tmp))) {
+					kind = Bk_MOVE;
+				}
+				expr = st->Ist.WrTmp.data;
+				switch (expr->tag) {
+					case Iex_Get:
+						if (isFpReg(expr->Iex.Get.offset, expr->Iex.Get.ty)) {
+							kind = Bk_MOVE;
+						}
+						break;
+					case Iex_GetI:
+						kind = Bk_MOVE;
+						break;
+					case Iex_Unop:
+						if (isShadowedOp(expr->Iex.Unop.op)) {
+							return Bk_FP;
+						}
+						break;
+					case Iex_Binop:
+						if (isShadowedOp(expr->Iex.Binop.op)) {
+							return Bk_FP;
+						}
+						break;
+					case Iex_Triop:
+						if (isShadowedOp(expr->Iex.Triop.op)) {
+							return Bk_FP;
+						}
+						break;
+					default:
+						break;
+				}
+				break;
+			default:
+				break;
+		}
+	}
+	return kind;
+}
+
+/* The shadow value of a temporary that tmpInstead redirects is read
+   through the other one. */
+static __inline__
+void noteShadowRead(IRExpr* e, Int j, Int* tmpInstead, Int* lastRead) {
+	if (e->tag == Iex_RdTmp) {
+		IRTemp t = e->Iex.RdTmp.tmp;
+		lastRead[tmpInstead[t] >= 0 ? tmpInstead[t] : t] = j;
+	}
+}
+
+/* Sets lastRead to the index of the last statement that reads the shadow
+   value of each temporary, for the in-place sums of --exact-sums. */
+static void findLastShadowReads(IRSB* sb, Int first, Int* tmpInstead, Int* lastRead) {
+	IRExpr* expr;
+	Int j;
+
+	for (j = 0; j < sb->tyenv->types_used; j++) {
+		lastRead[j] = -1;
+	}
+	for (j = first; j < sb->stmts_used; j++) {
+		IRStmt* st = sb->stmts[j];
+		if (!st) continue;
+
+		switch (st->tag) {
+			case Ist_Put:
+				noteShadowRead(st->Ist.Put.data, j, tmpInstead, lastRead);
+				break;
+			case Ist_PutI:
+				noteShadowRead(st->Ist.PutI.data, j, tmpInstead, lastRead);
+				break;
+			case Ist_Store:
+				noteShadowRead(st->Ist.Store.data, j, tmpInstead, lastRead);
+				break;
+			case Ist_WrTmp:
+				expr = st->Ist.WrTmp.data;
+				switch (expr->tag) {
+					case Iex_RdTmp:
+						noteShadowRead(expr, j, tmpInstead, lastRead);
+						break;
+					case Iex_Unop:
+						noteShadowRead(expr->Iex.Unop.arg, j, tmpInstead, lastRead);
+						break;
+					case Iex_Binop:
+						noteShadowRead(expr->Iex.Binop.arg1, j, tmpInstead, lastRead);
+						noteShadowRead(expr->Iex.Binop.arg2, j, tmpInstead, lastRead);
+						break;
+					case Iex_Triop:
+						noteShadowRead(expr->Iex.Triop.arg2, j, tmpInstead, lastRead);
+						noteShadowRead(expr->Iex.Triop.arg3, j, tmpInstead, lastRead);
+						break;
+					case Iex_Mux0X:
+						noteShadowRead(expr->Iex.Mux0X.expr0, j, tmpInstead, lastRead);
+						noteShadowRead(expr->Iex.Mux0X.exprX, j, tmpInstead, lastRead);
+						break;
+					default:
+						break;
+				}
+				break;
+			default:
+				break;
+		}
+	}
 }
 
-static void reportUnsupportedOp(IROp op) {
-	if (!VG_(OSetWord_Contains)(unsupportedOps, (UWord)op)) {
-		VG_(OSetWord_Insert)(unsupportedOps, (UWord)op);
+/* bit num of OpDesc.lastUse for the argument of the statement at index i */
+static __inline__
+UInt lastShadowUse(IRExpr* arg, Int num, Int argTmpInstead, Int* lastRead, Int i) {
+	if (arg->tag != Iex_RdTmp) {
+		return 0;
 	}
+	return lastRead[argTmpInstead >= 0 ? argTmpInstead : (Int)arg->Iex.RdTmp.tmp] == i ? 1 << num : 0;
 }
 
 static IRSB* fd_instrument(VgCallbackClosure* closure, IRSB* sbIn,
@@ -1816,10 +4238,17 @@ static IRSB* fd_instrument(VgCallbackClosure* closure, IRSB* sbIn,
 		maxTemps = tyenv->types_used;
 	}
 
+	BlockKind kind = clo_skipIntBlocks ? classifySB(sbIn, i) : Bk_FP;
+	if (kind == Bk_INT) {
+		intBlocks++;
+	} else if (kind == Bk_MOVE) {
+		moveBlocks++;
+	}
+
 	Int j;
 
-	Bool impReg[MAX_REGISTERS];
-	for (j = 0; j < MAX_REGISTERS; j++) {
+	Bool impReg[layout->total_sizeB];
+	for (j = 0; j < layout->total_sizeB; j++) {
 		impReg[j] = True;
 	}
 	Int impTmp[tyenv->types_used];
@@ -1854,21 +4283,8 @@ static IRSB* fd_instrument(VgCallbackClosure* closure, IRSB* sbIn,
 						break;
 					case Iex_Unop:
 						switch (expr->Iex.Unop.op) {
-							case Iop_Sqrt32F0x4:
-							case Iop_Sqrt64F0x2:
-							case Iop_NegF32:
-							case Iop_NegF64:
-							case Iop_AbsF32:
-							case Iop_AbsF64:
-							case Iop_F32toF64:
-							case Iop_ReinterpI64asF64:
-							case Iop_32UtoV128:
-							case Iop_V128to64:
-							case Iop_V128HIto64:
-							case Iop_64to32:
-							case Iop_64HIto32:
-							case Iop_64UtoV128:
-							case Iop_32Uto64:
+							SHADOWED_UNOPS(SHADOWED_CASE)
+							MOVED_UNOPS(MOVED_CASE)
 								if (expr->Iex.Unop.arg->tag == Iex_RdTmp) {
 									impTmp[expr->Iex.Unop.arg->Iex.RdTmp.tmp] = 1;
 								}
@@ -1883,22 +4299,9 @@ static IRSB* fd_instrument(VgCallbackClosure* closure, IRSB* sbIn,
 						break;
 					case Iex_Binop:
 						switch (expr->Iex.Binop.op) {
-							case Iop_Add32F0x4:
-							case Iop_Sub32F0x4:
-							case Iop_Mul32F0x4:
-							case Iop_Div32F0x4:
-							case Iop_Add64F0x2:
-							case Iop_Sub64F0x2:
-							case Iop_Mul64F0x2:
-							case Iop_Div64F0x2:
-							case Iop_Min32F0x4:
-							case Iop_Min64F0x2:
-							case Iop_Max32F0x4:
-							case Iop_Max64F0x2:
+							SHADOWED_BINOPS(SHADOWED_CASE)
 							/* case Iop_CmpF64: */
-							case Iop_F64toF32:
-							case Iop_64HLtoV128:
-							case Iop_32HLto64:
+							MOVED_BINOPS(MOVED_CASE)
 								if (expr->Iex.Binop.arg1->tag == Iex_RdTmp) {
 									impTmp[expr->Iex.Binop.arg1->Iex.RdTmp.tmp] = 1;
 								}
@@ -1919,10 +4322,7 @@ static IRSB* fd_instrument(VgCallbackClosure* closure, IRSB* sbIn,
 						break;
 					case Iex_Triop:
 						switch (expr->Iex.Triop.op) {
-							case Iop_AddF64:
-							case Iop_SubF64:
-							case Iop_MulF64:
-							case Iop_DivF64:
+							SHADOWED_TRIOPS(SHADOWED_CASE)
 								if (expr->Iex.Triop.arg2->tag == Iex_RdTmp) {
 									impTmp[expr->Iex.Triop.arg2->Iex.RdTmp.tmp] = 1;
 								}
@@ -1942,7 +4342,15 @@ static IRSB* fd_instrument(VgCallbackClosure* closure, IRSB* sbIn,
 						}
 						break;
 					case Iex_Mux0X:
-						/* nothing, impTmp is already true */
+						if (expr->Iex.Mux0X.expr0->tag == Iex_RdTmp) {
+							impTmp[expr->Iex.Mux0X.expr0->Iex.RdTmp.tmp] = 1;
+						}
+						if (expr->Iex.Mux0X.exprX->tag == Iex_RdTmp) {
+							impTmp[expr->Iex.Mux0X.exprX->Iex.RdTmp.tmp] = 1;
+						}
+						break;
+					case Iex_RdTmp:
+						impTmp[expr->Iex.RdTmp.tmp] = 1;
 						break;
 					default:
 						break;
@@ -1958,8 +4366,8 @@ static IRSB* fd_instrument(VgCallbackClosure* closure, IRSB* sbIn,
 		tmpInstead[j] = -1;
 	}
 
-	Int tmpInReg[MAX_REGISTERS];
-	for (j = 0; j < MAX_REGISTERS; j++) {
+	Int tmpInReg[layout->total_sizeB];
+	for (j = 0; j < layout->total_sizeB; j++) {
 		tmpInReg[j] = -1;
 	}
 
@@ -1997,15 +4405,7 @@ static IRSB* fd_instrument(VgCallbackClosure* closure, IRSB* sbIn,
 						break;
 					case Iex_Unop:
 						switch (expr->Iex.Unop.op) {
-							case Iop_F32toF64:
-							case Iop_ReinterpI64asF64:
-							case Iop_32UtoV128:
-							case Iop_V128to64:
-							case Iop_V128HIto64:
-							case Iop_64to32:
-							case Iop_64HIto32:
-							case Iop_64UtoV128:
-							case Iop_32Uto64:
+							MOVED_UNOPS(MOVED_CASE)
 								if (expr->Iex.Unop.arg->tag == Iex_RdTmp) {
 									if (tmpInstead[expr->Iex.Unop.arg->Iex.RdTmp.tmp] >= 0) {
 										tmpInstead[st->Ist.WrTmp.tmp] = tmpInstead[expr->Iex.Unop.arg->Iex.RdTmp.tmp];
@@ -2058,10 +4458,16 @@ static IRSB* fd_instrument(VgCallbackClosure* closure, IRSB* sbIn,
 		}
 	}
 
+	Int lastRead[tyenv->types_used];
+	if (clo_exactSums) {
+		findLastShadowReads(sbIn, i, tmpInstead, lastRead);
+	}
+
 	instrumentEnterSB(sbOut);
 
 	Int arg1tmpInstead = -1;
 	Int arg2tmpInstead = -1;
+	UInt lastUse = 0;
 
 	/* This is the main loop which hads instructions for the analysis (instrumentation).*/
 
@@ -2077,12 +4483,14 @@ static IRSB* fd_instrument(VgCallbackClosure* closure, IRSB* sbIn,
 				addStmtToIRSB(sbOut, st);
 				putCount++;
 
-				if (st->Ist.Put.offset != 168) {
+				if (st->Ist.Put.offset != 168 && kind == Bk_INT) {
+					instrumentPutNone(sbOut, st, layout);
+				} else if (st->Ist.Put.offset != 168) {
 					arg1tmpInstead = -1;
 					if (st->Ist.Put.data->tag == Iex_RdTmp) {
 						arg1tmpInstead = tmpInstead[st->Ist.Put.data->Iex.RdTmp.tmp];
 					}
-					instrumentPut(sbOut, tyenv, st, arg1tmpInstead);
+					instrumentPut(sbOut, tyenv, st, arg1tmpInstead, layout);
 				} else {
 					putsIgnored++;
 				}
@@ -2093,7 +4501,7 @@ static IRSB* fd_instrument(VgCallbackClosure* closure, IRSB* sbIn,
 				if (st->Ist.PutI.data->tag == Iex_RdTmp) {
 					arg1tmpInstead = tmpInstead[st->Ist.PutI.data->Iex.RdTmp.tmp];
 				}
-				instrumentPutI(sbOut, tyenv, st, arg1tmpInstead);
+				instrumentPutI(sbOut, tyenv, st, arg1tmpInstead, layout);
 				break;
 			case Ist_IMark:
 				/* address of current instruction */
@@ -2115,14 +4523,23 @@ static IRSB* fd_instrument(VgCallbackClosure* closure, IRSB* sbIn,
 					case Iex_Load:
 						addStmtToIRSB(sbOut, st);
 						loadCount++;
-						instrumentLoad(sbOut, tyenv, st);
+
+						/* the value is neither stored nor put, or it is not a float */
+						if (kind == Bk_INT || (kind == Bk_MOVE && impTmp[st->Ist.WrTmp.tmp] <= 0) ||
+								!isShadowedType(expr->Iex.Load.ty)) {
+							loadsIgnored++;
+						} else {
+							instrumentLoad(sbOut, tyenv, st);
+						}
 						break;
 					case Iex_Get:
 						addStmtToIRSB(sbOut, st);
 						getCount++;
 
-						if (tmpInstead[st->Ist.WrTmp.tmp] < 0) {
-							instrumentGet(sbOut, tyenv, st);
+						if (kind == Bk_INT || (kind == Bk_MOVE && impTmp[st->Ist.WrTmp.tmp] <= 0)) {
+							getsIgnored++;
+						} else if (tmpInstead[st->Ist.WrTmp.tmp] < 0) {
+							instrumentGet(sbOut, tyenv, st, layout);
 						} else {
 							getsIgnored++;
 						}
@@ -2130,18 +4547,16 @@ static IRSB* fd_instrument(VgCallbackClosure* closure, IRSB* sbIn,
 					case Iex_GetI:
 						addStmtToIRSB(sbOut, st);
 
+						if (kind == Bk_MOVE && impTmp[st->Ist.WrTmp.tmp] <= 0) {
+							break;
+						}
 						if (tmpInstead[st->Ist.WrTmp.tmp] < 0) {
-							instrumentGetI(sbOut, tyenv, st);
+							instrumentGetI(sbOut, tyenv, st, layout);
 						}
 						break;
 					case Iex_Unop:
 						switch (expr->Iex.Unop.op) {
-							case Iop_Sqrt32F0x4:
-							case Iop_Sqrt64F0x2:
-							case Iop_NegF32:
-							case Iop_NegF64:
-							case Iop_AbsF32:
-							case Iop_AbsF64:
+							SHADOWED_UNOPS(SHADOWED_CASE)
 								addStmtToIRSB(sbOut, st);
 
 								arg1tmpInstead = -1;
@@ -2150,15 +4565,7 @@ static IRSB* fd_instrument(VgCallbackClosure* closure, IRSB* sbIn,
 								}
 								instrumentUnOp(sbOut, tyenv, cia, st->Ist.WrTmp.tmp, expr, arg1tmpInstead);
 								break;
-							case Iop_F32toF64:
-							case Iop_ReinterpI64asF64:
-							case Iop_32UtoV128:
-							case Iop_V128to64:
-							case Iop_V128HIto64:
-							case Iop_64to32:
-							case Iop_64HIto32:
-							case Iop_64UtoV128:
-							case Iop_32Uto64:
+							MOVED_UNOPS(MOVED_CASE)
 								/* ignored floating-point and related SSE operations */
 								addStmtToIRSB(sbOut, st);
 								break;
@@ -2196,18 +4603,7 @@ static IRSB* fd_instrument(VgCallbackClosure* closure, IRSB* sbIn,
 						break;
 					case Iex_Binop:
 						switch (expr->Iex.Binop.op) {
-							case Iop_Add32F0x4:
-							case Iop_Sub32F0x4:
-							case Iop_Mul32F0x4:
-							case Iop_Div32F0x4:
-							case Iop_Add64F0x2:
-							case Iop_Sub64F0x2:
-							case Iop_Mul64F0x2:
-							case Iop_Div64F0x2:
-							case Iop_Min32F0x4:
-							case Iop_Min64F0x2:
-							case Iop_Max32F0x4:
-							case Iop_Max64F0x2:
+							SHADOWED_BINOPS(SHADOWED_CASE)
 								addStmtToIRSB(sbOut, st);
 
 								arg1tmpInstead = -1;
@@ -2218,12 +4614,14 @@ static IRSB* fd_instrument(VgCallbackClosure* closure, IRSB* sbIn,
 								if (expr->Iex.Binop.arg2->tag == Iex_RdTmp) {
 									arg2tmpInstead = tmpInstead[expr->Iex.Binop.arg2->Iex.RdTmp.tmp];
 								}
-								instrumentBinOp(sbOut, tyenv, cia, st->Ist.WrTmp.tmp, expr, arg1tmpInstead, arg2tmpInstead);
+								if (clo_exactSums) {
+									lastUse = lastShadowUse(expr->Iex.Binop.arg1, 0, arg1tmpInstead, lastRead, i) |
+										lastShadowUse(expr->Iex.Binop.arg2, 1, arg2tmpInstead, lastRead, i);
+								}
+								instrumentBinOp(sbOut, tyenv, cia, st->Ist.WrTmp.tmp, expr, arg1tmpInstead, arg2tmpInstead, lastUse);
 								break;
 							case Iop_CmpF64:
-							case Iop_F64toF32:
-							case Iop_64HLtoV128:
-							case Iop_32HLto64:
+							MOVED_BINOPS(MOVED_CASE)
 								/* ignored floating-point and related SSE operations */
 								addStmtToIRSB(sbOut, st);
 								break;
@@ -2267,10 +4665,7 @@ static IRSB* fd_instrument(VgCallbackClosure* closure, IRSB* sbIn,
 						break;
 					case Iex_Triop:
 						switch (expr->Iex.Triop.op) {
-							case Iop_AddF64:
-							case Iop_SubF64:
-							case Iop_MulF64:
-							case Iop_DivF64:
+							SHADOWED_TRIOPS(SHADOWED_CASE)
 								addStmtToIRSB(sbOut, st);
 								
 								arg1tmpInstead = -1;
@@ -2281,7 +4676,11 @@ static IRSB* fd_instrument(VgCallbackClosure* closure, IRSB* sbIn,
 								if (expr->Iex.Triop.arg3->tag == Iex_RdTmp) {
 									arg2tmpInstead = tmpInstead[expr->Iex.Triop.arg3->Iex.RdTmp.tmp];
 								}
-								instrumentTriOp(sbOut, tyenv, cia, st->Ist.WrTmp.tmp, expr, arg1tmpInstead, arg2tmpInstead);
+								if (clo_exactSums) {
+									lastUse = lastShadowUse(expr->Iex.Triop.arg2, 1, arg1tmpInstead, lastRead, i) |
+										lastShadowUse(expr->Iex.Triop.arg3, 2, arg2tmpInstead, lastRead, i);
+								}
+								instrumentTriOp(sbOut, tyenv, cia, st->Ist.WrTmp.tmp, expr, arg1tmpInstead, arg2tmpInstead, lastUse);
 								break;
 							case Iop_AddF32:
 							case Iop_SubF32:
@@ -2323,6 +4722,9 @@ static IRSB* fd_instrument(VgCallbackClosure* closure, IRSB* sbIn,
 						break;
 					case Iex_Mux0X:
 						addStmtToIRSB(sbOut, st);
+						if (kind == Bk_INT) {
+							break;
+						}
 
 						arg1tmpInstead = -1;
 						arg2tmpInstead = -1;
@@ -2344,6 +4746,13 @@ static IRSB* fd_instrument(VgCallbackClosure* closure, IRSB* sbIn,
 				break;
 			case Ist_Store:
 				addStmtToIRSB(sbOut, st);
+				if (kind == Bk_INT || st->Ist.Store.data->tag == Iex_Const ||
+						!isShadowedType(typeOfIRExpr(tyenv, st->Ist.Store.data))) {
+					instrumentStoreNone(sbOut, st);
+					storeCount++;
+					storesIgnored++;
+					break;
+				}
 
 				arg1tmpInstead = -1;
 				if (st->Ist.Store.data->tag == Iex_RdTmp) {
@@ -2636,31 +5045,32 @@ static Bool dumpGraph(Char* fileName, ULong addr, Bool conditional, Bool careVis
 		return False;
 	}
 
-	ShadowValue* svalue = VG_(HT_lookup)(globalMemory, addr);
+	ShadowValue* svalue = getShadowMem(addr);
 	if (svalue) {
 		if (careVisited) {
-			MeanValue* mv = VG_(HT_lookup)(meanValues, svalue->origin);
+			MeanValue* mv = VG_(HT_lookup)(meanValues, dataCold(svalue->data)->origin);
 			tl_assert(mv);
 			if (mv->visited) {
 				return False;
 			}
 		}
 
-		VG_(describe_IP)(svalue->origin, description, DESCRIPTION_SIZE);
+		VG_(describe_IP)(dataCold(svalue->data)->origin, description, DESCRIPTION_SIZE);
 		if (ignoreFile(description)) {
 			return False;
 		}
 
-		if (svalue->orgType == Ot_FLOAT) {
-			mpfr_set_flt(dumpGraphOrg, svalue->Org.fl, STD_RND);
-		} else if (svalue->orgType == Ot_DOUBLE) {
-			mpfr_set_d(dumpGraphOrg, svalue->Org.db, STD_RND);
+		if (svCold(svalue)->orgType == Ot_FLOAT) {
+			mpfr_set_flt(dumpGraphOrg, svCold(svalue)->Org.fl, STD_RND);
+		} else if (svCold(svalue)->orgType == Ot_DOUBLE) {
+			mpfr_set_d(dumpGraphOrg, svCold(svalue)->Org.db, STD_RND);
 		} else {
 			tl_assert(False);
 		}
 
-		if (mpfr_cmp_ui(svalue->value, 0) != 0 || mpfr_cmp_ui(dumpGraphOrg, 0) != 0) {
-			mpfr_reldiff(dumpGraphRel, svalue->value, dumpGraphOrg, STD_RND);
+		materialize(svalue->data);
+		if (mpfr_cmp_ui(svalue->data->value, 0) != 0 || mpfr_cmp_ui(dumpGraphOrg, 0) != 0) {
+			mpfr_reldiff(dumpGraphRel, svalue->data->value, dumpGraphOrg, STD_RND);
 			mpfr_abs(dumpGraphRel, dumpGraphRel, STD_RND);
 		} else {
 			mpfr_set_ui(dumpGraphRel, 0, STD_RND);
@@ -2672,7 +5082,7 @@ static Bool dumpGraph(Char* fileName, ULong addr, Bool conditional, Bool careVis
 
 		SysRes file = VG_(open)(fileName, VKI_O_CREAT|VKI_O_TRUNC|VKI_O_WRONLY, VKI_S_IRUSR|VKI_S_IWUSR);
 		if (!sr_isError(file)) {
-			writeOriginGraph(sr_Res(file), 0, svalue->origin, 0, 1, 1, careVisited);
+			writeOriginGraph(sr_Res(file), 0, dataCold(svalue->data)->origin, 0, 1, 1, careVisited);
 			my_fwrite(sr_Res(file), "}\n", 2);
 			fwrite_flush();
 			VG_(close)(sr_Res(file));
@@ -2692,22 +5102,23 @@ static Bool dumpGraph(Char* fileName, ULong addr, Bool conditional, Bool careVis
 static void printError(Char* varName, ULong addr, Bool conditional) {
 	mpfr_t org, diff, rel;
 
-	ShadowValue* svalue = VG_(HT_lookup)(globalMemory, addr);
+	ShadowValue* svalue = getShadowMem(addr);
 	if (svalue) {
+		materialize(svalue->data);
 		mpfr_inits(diff, rel, NULL);
 		
-		Bool isFloat = svalue->orgType == Ot_FLOAT;
-		if (svalue->orgType == Ot_FLOAT) {
+		Bool isFloat = svCold(svalue)->orgType == Ot_FLOAT;
+		if (svCold(svalue)->orgType == Ot_FLOAT) {
 			mpfr_init(org);
-			mpfr_set_flt(org, svalue->Org.fl, STD_RND);
-		} else if (svalue->orgType == Ot_DOUBLE) {
-			mpfr_init_set_d(org, svalue->Org.db, STD_RND);
+			mpfr_set_flt(org, svCold(svalue)->Org.fl, STD_RND);
+		} else if (svCold(svalue)->orgType == Ot_DOUBLE) {
+			mpfr_init_set_d(org, svCold(svalue)->Org.db, STD_RND);
 		} else {
 			tl_assert(False);
 		}
 
-		if (mpfr_cmp_ui(svalue->value, 0) != 0 || mpfr_cmp_ui(org, 0) != 0) {
-			mpfr_reldiff(rel, svalue->value, org, STD_RND);
+		if (mpfr_cmp_ui(svalue->data->value, 0) != 0 || mpfr_cmp_ui(org, 0) != 0) {
+			mpfr_reldiff(rel, svalue->data->value, org, STD_RND);
 			mpfr_abs(rel, rel, STD_RND);
 		} else {
 			mpfr_set_ui(rel, 0, STD_RND);
@@ -2718,7 +5129,7 @@ static void printError(Char* varName, ULong addr, Bool conditional) {
 			return;
 		}
 
-		mpfr_sub(diff, svalue->value, org, STD_RND);
+		mpfr_sub(diff, svalue->data->value, org, STD_RND);
 
 		Char typeName[7];
 		if (isFloat) {
@@ -2731,23 +5142,23 @@ static void printError(Char* varName, ULong addr, Bool conditional) {
 		Char mpfrBuf[MPFR_BUFSIZE];
 		mpfrToString(mpfrBuf, &org);
 		VG_(umsg)("(%s) %s ORIGINAL:         %s\n", typeName, varName, mpfrBuf);
-		mpfrToString(mpfrBuf, &(svalue->value));
+		mpfrToString(mpfrBuf, &(svalue->data->value));
 		VG_(umsg)("(%s) %s SHADOW VALUE:     %s\n", typeName, varName, mpfrBuf);
 		mpfrToString(mpfrBuf, &diff);
 		VG_(umsg)("(%s) %s ABSOLUTE ERROR:   %s\n", typeName, varName, mpfrBuf);
 		mpfrToString(mpfrBuf, &rel);
 		VG_(umsg)("(%s) %s RELATIVE ERROR:   %s\n", typeName, varName, mpfrBuf);
-		VG_(umsg)("(%s) %s CANCELED BITS:     %lld\n", typeName, varName, svalue->canceled);
+		VG_(umsg)("(%s) %s CANCELED BITS:     %lld\n", typeName, varName, dataCold(svalue->data)->canceled);
 
-		VG_(describe_IP)(svalue->origin, description, DESCRIPTION_SIZE);
+		VG_(describe_IP)(dataCold(svalue->data)->origin, description, DESCRIPTION_SIZE);
 		VG_(umsg)("(%s) %s Last operation: %s\n", typeName, varName, description);
 
-		if (svalue->canceled > 0 && svalue->cancelOrigin > 0) {
-			VG_(describe_IP)(svalue->cancelOrigin, description, DESCRIPTION_SIZE);
+		if (dataCold(svalue->data)->canceled > 0 && dataCold(svalue->data)->cancelOrigin > 0) {
+			VG_(describe_IP)(dataCold(svalue->data)->cancelOrigin, description, DESCRIPTION_SIZE);
 			VG_(umsg)("(%s) %s Cancellation origin: %s\n", typeName, varName, description);
 		}
 		
-		VG_(umsg)("(%s) %s Operation count (max path): %'lu\n", typeName, varName, svalue->opCount);
+		VG_(umsg)("(%s) %s Operation count (max path): %'lu\n", typeName, varName, dataCold(svalue->data)->opCount);
 
 		mpfr_clears(org, diff, rel, NULL);
 	} else {
@@ -2760,22 +5171,23 @@ static Bool isErrorGreater(ULong addrFp, ULong addrErr) {
 	mpfr_t org, rel;
 	Double* errorBound = (Double*)addrErr;
 
-	ShadowValue* svalue = VG_(HT_lookup)(globalMemory, addrFp);
+	ShadowValue* svalue = getShadowMem(addrFp);
 	if (svalue) {
+		materialize(svalue->data);
 		mpfr_init(rel);
 		
-		Bool isFloat = svalue->orgType == Ot_FLOAT;
-		if (svalue->orgType == Ot_FLOAT) {
+		Bool isFloat = svCold(svalue)->orgType == Ot_FLOAT;
+		if (svCold(svalue)->orgType == Ot_FLOAT) {
 			mpfr_init(org);
-			mpfr_set_flt(org, svalue->Org.fl, STD_RND);
-		} else if (svalue->orgType == Ot_DOUBLE) {
-			mpfr_init_set_d(org, svalue->Org.db, STD_RND);
+			mpfr_set_flt(org, svCold(svalue)->Org.fl, STD_RND);
+		} else if (svCold(svalue)->orgType == Ot_DOUBLE) {
+			mpfr_init_set_d(org, svCold(svalue)->Org.db, STD_RND);
 		} else {
 			tl_assert(False);
 		}
 
-		if (mpfr_cmp_ui(svalue->value, 0) != 0 || mpfr_cmp_ui(org, 0) != 0) {
-			mpfr_reldiff(rel, svalue->value, org, STD_RND);
+		if (mpfr_cmp_ui(svalue->data->value, 0) != 0 || mpfr_cmp_ui(org, 0) != 0) {
+			mpfr_reldiff(rel, svalue->data->value, org, STD_RND);
 			mpfr_abs(rel, rel, STD_RND);
 		} else {
 			mpfr_set_ui(rel, 0, STD_RND);
@@ -2794,34 +5206,38 @@ static Bool isErrorGreater(ULong addrFp, ULong addrErr) {
 
 static void resetShadowValues(void) {
 	Int i, j;
-	for (i = 0; i < VG_N_THREADS; i++) {
-		for (j = 0; j < MAX_REGISTERS; j++) {
-			if (threadRegisters[i][j] != NULL) {
-				threadRegisters[i][j]->active = False;
-			}
-		}
+	ThreadId tid;
+	Addr stackMin, stackMax;
+	VG_(thread_stack_reset_iter)(&tid);
+	while (VG_(thread_stack_next)(&tid, &stackMin, &stackMax)) {
+		dropRegShadows(tid, True);
 	}
 	for (i = 0; i < MAX_TEMPS; i++) {
 		if (localTemps[i] != NULL) {
 			localTemps[i]->version = 0;
 		}
+		tempShadowed[i] = 0;
 	}
-	ShadowValue* next;
-	VG_(HT_ResetIter)(globalMemory);
-	while (next = VG_(HT_Next)(globalMemory)) {
-		next->active = False;
+	ShadowSecMap* sm;
+	for (sm = allSecMaps; sm; sm = sm->allNext) {
+		for (j = 0; j < SM_SLOTS && sm->used > 0; j++) {
+			if (sm->slots[j] != NULL) {
+				sm->slots[j]->active = False;
+			}
+		}
 	}
 }
 
 static void insertShadow(ULong addrFp) {
-	ShadowValue* svalue = VG_(HT_lookup)(globalMemory, addrFp);
+	ShadowValue* svalue = getShadowMem(addrFp);
 	if (svalue) {
-		if (svalue->orgType == Ot_FLOAT) {
+		materialize(svalue->data);
+		if (svCold(svalue)->orgType == Ot_FLOAT) {
 			Float* orgFl = (Float*)addrFp;
-			*orgFl = mpfr_get_flt(svalue->value, STD_RND);
-		} else if (svalue->orgType == Ot_DOUBLE) {
+			*orgFl = mpfr_get_flt(svalue->data->value, STD_RND);
+		} else if (svCold(svalue)->orgType == Ot_DOUBLE) {
 			Double* orgDb = (Double*)addrFp;
-			*orgDb = mpfr_get_d(svalue->value, STD_RND);
+			*orgDb = mpfr_get_d(svalue->data->value, STD_RND);
 		} else {
 			tl_assert(False);
 		}
@@ -2865,24 +5281,25 @@ static void writeWarning(Int file) {
 
 static void writeShadowValue(Int file, ShadowValue* svalue, Int num) {
 	tl_assert(svalue);
+	materialize(svalue->data);
 
-	Bool isFloat = svalue->orgType == Ot_FLOAT;
-	if (svalue->orgType == Ot_FLOAT) {
-		mpfr_set_flt(writeSvOrg, svalue->Org.fl, STD_RND);
-	} else if (svalue->orgType == Ot_DOUBLE) {
-		mpfr_set_d(writeSvOrg, svalue->Org.db, STD_RND);
+	Bool isFloat = svCold(svalue)->orgType == Ot_FLOAT;
+	if (svCold(svalue)->orgType == Ot_FLOAT) {
+		mpfr_set_flt(writeSvOrg, svCold(svalue)->Org.fl, STD_RND);
+	} else if (svCold(svalue)->orgType == Ot_DOUBLE) {
+		mpfr_set_d(writeSvOrg, svCold(svalue)->Org.db, STD_RND);
 	} else {
 		tl_assert(False);
 	}
 
-	if (mpfr_cmp_ui(svalue->value, 0) != 0 || mpfr_cmp_ui(writeSvOrg, 0) != 0) {
-		mpfr_reldiff(writeSvRelError, svalue->value, writeSvOrg, STD_RND);
+	if (mpfr_cmp_ui(svalue->data->value, 0) != 0 || mpfr_cmp_ui(writeSvOrg, 0) != 0) {
+		mpfr_reldiff(writeSvRelError, svalue->data->value, writeSvOrg, STD_RND);
 		mpfr_abs(writeSvRelError, writeSvRelError, STD_RND);
 	} else {
 		mpfr_set_ui(writeSvRelError, 0, STD_RND);
 	}
 
-	mpfr_sub(writeSvDiff, svalue->value, writeSvOrg, STD_RND);
+	mpfr_sub(writeSvDiff, svalue->data->value, writeSvOrg, STD_RND);
 
 	Char mpfrBuf[MPFR_BUFSIZE];
 	Char typeName[7];
@@ -2897,7 +5314,7 @@ static void writeShadowValue(Int file, ShadowValue* svalue, Int num) {
 	mpfrToString(mpfrBuf, &writeSvOrg);
 	VG_(sprintf)(formatBuf, "    original:         %s\n", mpfrBuf);
 	my_fwrite(file, (void*)formatBuf, VG_(strlen)(formatBuf));
-	mpfrToString(mpfrBuf, &(svalue->value));
+	mpfrToString(mpfrBuf, &(svalue->data->value));
 	VG_(sprintf)(formatBuf, "    shadow value:     %s\n", mpfrBuf);
 	my_fwrite(file, (void*)formatBuf, VG_(strlen)(formatBuf));
 	mpfrToString(mpfrBuf, &writeSvDiff);
@@ -2906,29 +5323,35 @@ static void writeShadowValue(Int file, ShadowValue* svalue, Int num) {
 	mpfrToString(mpfrBuf, &writeSvRelError);
 	VG_(sprintf)(formatBuf, "    relative error:   %s\n", mpfrBuf);
 	my_fwrite(file, (void*)formatBuf, VG_(strlen)(formatBuf));
-	VG_(sprintf)(formatBuf, "    maximum number of canceled bits: %ld\n", svalue->canceled);
+	VG_(sprintf)(formatBuf, "    maximum number of canceled bits: %ld\n", dataCold(svalue->data)->canceled);
 	my_fwrite(file, (void*)formatBuf, VG_(strlen)(formatBuf));
 
-	if (svalue->canceled > 0 && svalue->cancelOrigin > 0) {
-		VG_(describe_IP)(svalue->cancelOrigin, description, DESCRIPTION_SIZE);
+	if (dataCold(svalue->data)->canceled > 0 && dataCold(svalue->data)->cancelOrigin > 0) {
+		VG_(describe_IP)(dataCold(svalue->data)->cancelOrigin, description, DESCRIPTION_SIZE);
 		VG_(sprintf)(formatBuf, "    origin of maximum cancellation: %s\n", description);
 		my_fwrite(file, (void*)formatBuf, VG_(strlen)(formatBuf));
 	}
 
-	VG_(describe_IP)(svalue->origin, description, DESCRIPTION_SIZE);
+	VG_(describe_IP)(dataCold(svalue->data)->origin, description, DESCRIPTION_SIZE);
 	VG_(sprintf)(formatBuf, "    last operation: %s\n", description);
 	my_fwrite(file, (void*)formatBuf, VG_(strlen)(formatBuf));
-	VG_(sprintf)(formatBuf, "    operation count (max path): %'lu\n", svalue->opCount);
+	VG_(sprintf)(formatBuf, "    operation count (max path): %'lu\n", dataCold(svalue->data)->opCount);
 	my_fwrite(file, (void*)formatBuf, VG_(strlen)(formatBuf));
 }
 
 static Bool areSvsEqual(ShadowValue* sv1, ShadowValue* sv2) {
-	if (sv1->opCount == sv2->opCount && sv1->origin == sv2->origin && 
-		sv1->canceled == sv2->canceled && sv1->cancelOrigin == sv2->cancelOrigin && 
-		sv1->orgType == sv2->orgType && mpfr_cmp(sv1->value, sv2->value) == 0)
+	if (svCold(sv1)->orgType == svCold(sv2)->orgType && sv1->data == sv2->data) {
+		return (svCold(sv1)->orgType == Ot_FLOAT && svCold(sv1)->Org.fl == svCold(sv2)->Org.fl) || 
+			   (svCold(sv1)->orgType == Ot_DOUBLE && svCold(sv1)->Org.db == svCold(sv2)->Org.db); 
+	}
+	materialize(sv1->data);
+	materialize(sv2->data);
+	if (dataCold(sv1->data)->opCount == dataCold(sv2->data)->opCount && dataCold(sv1->data)->origin == dataCold(sv2->data)->origin && 
+		dataCold(sv1->data)->canceled == dataCold(sv2->data)->canceled && dataCold(sv1->data)->cancelOrigin == dataCold(sv2->data)->cancelOrigin && 
+		svCold(sv1)->orgType == svCold(sv2)->orgType && mpfr_cmp(sv1->data->value, sv2->data->value) == 0)
 	{
-		return (sv1->orgType == Ot_FLOAT && sv1->Org.fl == sv2->Org.fl) || 
-			   (sv1->orgType == Ot_DOUBLE && sv1->Org.db == sv2->Org.db); 
+		return (svCold(sv1)->orgType == Ot_FLOAT && svCold(sv1)->Org.fl == svCold(sv2)->Org.fl) || 
+			   (svCold(sv1)->orgType == Ot_DOUBLE && svCold(sv1)->Org.db == svCold(sv2)->Org.db); 
 	}
 	return False;
 }
@@ -2936,8 +5359,8 @@ static Bool areSvsEqual(ShadowValue* sv1, ShadowValue* sv2) {
 static Int compareShadowValues(void* n1, void* n2) {
 	ShadowValue* sv1 = *(ShadowValue**)n1;
 	ShadowValue* sv2 = *(ShadowValue**)n2;
-	if (sv1->opCount < sv2->opCount) return 1;
-	if (sv1->opCount > sv2->opCount) return -1;
+	if (dataCold(sv1->data)->opCount < dataCold(sv2->data)->opCount) return 1;
+	if (dataCold(sv1->data)->opCount > dataCold(sv2->data)->opCount) return -1;
 	if (sv1->key < sv2->key) return -1;
 	if (sv1->key > sv2->key) return 1;
 	return 0;
@@ -2968,10 +5391,10 @@ static void writeMemorySpecial(ShadowValue** memory, UInt n_memory) {
 		}
 		total++;
 
-		if (memory[i]->orgType == Ot_FLOAT) {
-			mpfr_set_flt(endAnalysisOrg, memory[i]->Org.fl, STD_RND);
-		} else if (memory[i]->orgType == Ot_DOUBLE) {
-			mpfr_set_d(endAnalysisOrg, memory[i]->Org.db, STD_RND);
+		if (svCold(memory[i])->orgType == Ot_FLOAT) {
+			mpfr_set_flt(endAnalysisOrg, svCold(memory[i])->Org.fl, STD_RND);
+		} else if (svCold(memory[i])->orgType == Ot_DOUBLE) {
+			mpfr_set_d(endAnalysisOrg, svCold(memory[i])->Org.db, STD_RND);
 		} else {
 			tl_assert(False);
 		}
@@ -2981,7 +5404,7 @@ static void writeMemorySpecial(ShadowValue** memory, UInt n_memory) {
 			specialFps++;
 
 			if (clo_ignoreLibraries) {
-				VG_(describe_IP)(memory[i]->origin, description, DESCRIPTION_SIZE);
+				VG_(describe_IP)(dataCold(memory[i]->data)->origin, description, DESCRIPTION_SIZE);
 				if (ignoreFile(description)) {
 					skippedLibrary++;
 					continue;
@@ -3046,11 +5469,11 @@ static void writeMemoryCanceled(ShadowValue** memory, UInt n_memory) {
 		}
 		total++;
 
-		if (memory[i]->canceled > CANCEL_LIMIT) {
+		if (dataCold(memory[i]->data)->canceled > CANCEL_LIMIT) {
 			fpsWithError++;
 
 			if (clo_ignoreLibraries) {
-				VG_(describe_IP)(memory[i]->origin, description, DESCRIPTION_SIZE);
+				VG_(describe_IP)(dataCold(memory[i]->data)->origin, description, DESCRIPTION_SIZE);
 				if (ignoreFile(description)) {
 					skippedLibrary++;
 					continue;
@@ -3116,23 +5539,24 @@ static void writeMemoryRelError(ShadowValue** memory, UInt n_memory) {
 		}
 		total++;
 
-		if (memory[i]->orgType == Ot_FLOAT) {
-			mpfr_set_flt(endAnalysisOrg, memory[i]->Org.fl, STD_RND);
-		} else if (memory[i]->orgType == Ot_DOUBLE) {
-			mpfr_set_d(endAnalysisOrg, memory[i]->Org.db, STD_RND);
+		if (svCold(memory[i])->orgType == Ot_FLOAT) {
+			mpfr_set_flt(endAnalysisOrg, svCold(memory[i])->Org.fl, STD_RND);
+		} else if (svCold(memory[i])->orgType == Ot_DOUBLE) {
+			mpfr_set_d(endAnalysisOrg, svCold(memory[i])->Org.db, STD_RND);
 		} else {
 			tl_assert(False);
 		}
 
 		Bool hasError = True;
-		if (mpfr_cmp_ui(memory[i]->value, 0) != 0 || mpfr_cmp_ui(endAnalysisOrg, 0) != 0) {
-			mpfr_reldiff(endAnalysisRelError, memory[i]->value, endAnalysisOrg, STD_RND);
+		materialize(memory[i]->data);
+		if (mpfr_cmp_ui(memory[i]->data->value, 0) != 0 || mpfr_cmp_ui(endAnalysisOrg, 0) != 0) {
+			mpfr_reldiff(endAnalysisRelError, memory[i]->data->value, endAnalysisOrg, STD_RND);
 
 			if (mpfr_cmp_ui(endAnalysisRelError, 0) != 0) {
 				fpsWithError++;
 
 				if (clo_ignoreLibraries) {
-					VG_(describe_IP)(memory[i]->origin, description, DESCRIPTION_SIZE);
+					VG_(describe_IP)(dataCold(memory[i]->data)->origin, description, DESCRIPTION_SIZE);
 					if (ignoreFile(description)) {
 						skippedLibrary++;
 						continue;
@@ -3193,8 +5617,8 @@ static void writeMemoryRelError(ShadowValue** memory, UInt n_memory) {
 
 static void endAnalysis(void) {
 	UInt n_memory = 0;
-	ShadowValue** memory = VG_(HT_to_array)(globalMemory, &n_memory);
-	VG_(ssort)(memory, n_memory, sizeof(VgHashNode*), compareShadowValues);
+	ShadowValue** memory = shadowMemToArray(&n_memory);
+	VG_(ssort)(memory, n_memory, sizeof(ShadowValue*), compareShadowValues);
 
 	writeMemoryRelError(memory, n_memory);
 	writeMemoryCanceled(memory, n_memory);
@@ -3444,6 +5868,163 @@ static void writeStageReports(Char* fname) {
 	VG_(umsg)("STAGE REPORTS (%s): successful\n", fname);
 }
 
+static Int compareShadowEvictions(void* n1, void* n2) {
+	ShadowEviction* ev1 = *(ShadowEviction**)n1;
+	ShadowEviction* ev2 = *(ShadowEviction**)n2;
+	if (ev1->count < ev2->count) return 1;
+	if (ev1->count > ev2->count) return -1;
+
+	if (ev1->key < ev2->key) return -1;
+	if (ev1->key > ev2->key) return 1;
+	return 0;
+}
+
+static void writeShadowEvictions(Char* fname) {
+	if (shadowEvicted == 0) {
+		return;
+	}
+
+	getFileName(fname);
+	SysRes fileRes = VG_(open)(fname, VKI_O_CREAT|VKI_O_TRUNC|VKI_O_WRONLY, VKI_S_IRUSR|VKI_S_IWUSR);
+	if (sr_isError(fileRes)) {
+		VG_(umsg)("SHADOW EVICTIONS (%s): Failed to create or open the file!\n", fname);
+		return;
+	}
+	Int file = sr_Res(fileRes);
+
+	VG_(sprintf)(formatBuf, "The shadow memory limit of %ld MB was reached. The errors reported for the\n"
+		"origins below may be incomplete, as their shadow values have been evicted.\n\n", clo_max_shadow_mb);
+	my_fwrite(file, (void*)formatBuf, VG_(strlen)(formatBuf));
+
+	UInt n_evictions = 0;
+	ShadowEviction** evictions = VG_(HT_to_array)(shadowEvictions, &n_evictions);
+	VG_(ssort)(evictions, n_evictions, sizeof(VgHashNode*), compareShadowEvictions);
+
+	Int i;
+	for (i = 0; i < n_evictions && i < MAX_ENTRIES_PER_FILE; i++) {
+		if (evictions[i]->key) {
+			VG_(describe_IP)(evictions[i]->key, description, DESCRIPTION_SIZE);
+		} else {
+			VG_(strcpy)(description, "(unknown origin)");
+		}
+		VG_(sprintf)(formatBuf, "%s (%'lu)\n", description, evictions[i]->count);
+		my_fwrite(file, (void*)formatBuf, VG_(strlen)(formatBuf));
+	}
+
+	VG_(sprintf)(formatBuf, "\n%'lu shadow values of %'u origins have been evicted\n", shadowEvicted, n_evictions);
+	my_fwrite(file, (void*)formatBuf, VG_(strlen)(formatBuf));
+
+	fwrite_flush();
+	VG_(close)(file);
+	VG_(free)(evictions);
+	VG_(umsg)("SHADOW EVICTIONS (%s): successful\n", fname);
+}
+
+static Int comparePromotedSites(void* n1, void* n2) {
+	PromotedSite* ps1 = *(PromotedSite**)n1;
+	PromotedSite* ps2 = *(PromotedSite**)n2;
+	if (ps1->count < ps2->count) return 1;
+	if (ps1->count > ps2->count) return -1;
+
+	if (ps1->key < ps2->key) return -1;
+	if (ps1->key > ps2->key) return 1;
+	return 0;
+}
+
+static void writePromotedSites(Char* fname) {
+	if (!clo_adaptivePrecision || VG_(HT_count_nodes)(promotedSites) == 0) {
+		return;
+	}
+
+	getFileName(fname);
+	SysRes fileRes = VG_(open)(fname, VKI_O_CREAT|VKI_O_TRUNC|VKI_O_WRONLY, VKI_S_IRUSR|VKI_S_IWUSR);
+	if (sr_isError(fileRes)) {
+		VG_(umsg)("PROMOTED SITES (%s): Failed to create or open the file!\n", fname);
+		return;
+	}
+	Int file = sr_Res(fileRes);
+
+	VG_(sprintf)(formatBuf, "The operations below compute their shadow values with %ld bits instead of\n"
+		"double-double, because of cancellations. The number of promotions is given.\n\n", clo_precision);
+	my_fwrite(file, (void*)formatBuf, VG_(strlen)(formatBuf));
+
+	UInt n_sites = 0;
+	PromotedSite** sites = VG_(HT_to_array)(promotedSites, &n_sites);
+	VG_(ssort)(sites, n_sites, sizeof(VgHashNode*), comparePromotedSites);
+
+	Int i;
+	for (i = 0; i < n_sites && i < MAX_ENTRIES_PER_FILE; i++) {
+		VG_(describe_IP)(sites[i]->key, description, DESCRIPTION_SIZE);
+		VG_(sprintf)(formatBuf, "%s (%'lu)\n", description, sites[i]->count);
+		my_fwrite(file, (void*)formatBuf, VG_(strlen)(formatBuf));
+	}
+
+	VG_(sprintf)(formatBuf, "\n%'u sites have been promoted, %'lu operations were computed with MPFR\n", n_sites, promotedOps);
+	my_fwrite(file, (void*)formatBuf, VG_(strlen)(formatBuf));
+
+	fwrite_flush();
+	VG_(close)(file);
+	VG_(free)(sites);
+	VG_(umsg)("PROMOTED SITES (%s): successful\n", fname);
+}
+
+static Int compareLaneSites(void* n1, void* n2) {
+	LaneSite* ls1 = *(LaneSite**)n1;
+	LaneSite* ls2 = *(LaneSite**)n2;
+	if (ls1->count < ls2->count) return 1;
+	if (ls1->count > ls2->count) return -1;
+
+	if (ls1->key < ls2->key) return -1;
+	if (ls1->key > ls2->key) return 1;
+	return 0;
+}
+
+static void writeLaneSites(Char* fname) {
+	if (clo_checkPrecision == 0) {
+		return;
+	}
+
+	getFileName(fname);
+	SysRes fileRes = VG_(open)(fname, VKI_O_CREAT|VKI_O_TRUNC|VKI_O_WRONLY, VKI_S_IRUSR|VKI_S_IWUSR);
+	if (sr_isError(fileRes)) {
+		VG_(umsg)("PRECISION CHECK (%s): Failed to create or open the file!\n", fname);
+		return;
+	}
+	Int file = sr_Res(fileRes);
+
+	VG_(sprintf)(formatBuf, "The relative errors of the operations below differ with %ld and %ld bits.\n"
+		"The number of operations and the errors of the largest difference are given.\n\n",
+		clo_precision, clo_checkPrecision);
+	my_fwrite(file, (void*)formatBuf, VG_(strlen)(formatBuf));
+
+	UInt n_sites = 0;
+	LaneSite** sites = VG_(HT_to_array)(laneSites, &n_sites);
+	VG_(ssort)(sites, n_sites, sizeof(VgHashNode*), compareLaneSites);
+
+	Char mpfrBuf[MPFR_BUFSIZE];
+	Char checkBuf[MPFR_BUFSIZE];
+	Int i;
+	for (i = 0; i < n_sites && i < MAX_ENTRIES_PER_FILE; i++) {
+		VG_(describe_IP)(sites[i]->key, description, DESCRIPTION_SIZE);
+		mpfrToStringShort(mpfrBuf, &(sites[i]->err));
+		mpfrToStringShort(checkBuf, &(sites[i]->checkErr));
+		VG_(sprintf)(formatBuf, "%s (%'lu): %s, %s\n", description, sites[i]->count, mpfrBuf, checkBuf);
+		my_fwrite(file, (void*)formatBuf, VG_(strlen)(formatBuf));
+	}
+
+	if (n_sites == 0) {
+		VG_(sprintf)(formatBuf, "No operation differs.\n");
+	} else {
+		VG_(sprintf)(formatBuf, "\n%'u sites differ\n", n_sites);
+	}
+	my_fwrite(file, (void*)formatBuf, VG_(strlen)(formatBuf));
+
+	fwrite_flush();
+	VG_(close)(file);
+	VG_(free)(sites);
+	VG_(umsg)("PRECISION CHECK (%s): successful\n", fname);
+}
+
 static void fd_fini(Int exitcode) {
 	endAnalysis();
 
@@ -3460,12 +6041,38 @@ static void fd_fini(Int exitcode) {
 	VG_(sprintf)(filename, "%s_stage_reports", clientName);
 	writeStageReports(filename);
 
+	VG_(sprintf)(filename, "%s_shadow_evictions", clientName);
+	writeShadowEvictions(filename);
+
+	VG_(sprintf)(filename, "%s_promoted_sites", clientName);
+	writePromotedSites(filename);
+
+	VG_(sprintf)(filename, "%s_precision_check", clientName);
+	writeLaneSites(filename);
+
 #ifndef NDEBUG
+	Int i;
 	VG_(umsg)("DEBUG - Client exited with code: %d\n", exitcode);
 	VG_(dmsg)("DEBUG - SBs: %'lu, executed: %'lu, instr: %'lu\n", sbCounter, sbExecuted, totalIns);
-	VG_(dmsg)("DEBUG - ShadowValues (frees/mallocs): %'lu/%'lu, diff: %'lu\n", avFrees, avMallocs, avMallocs - avFrees);
-	VG_(dmsg)("DEBUG - Floating-point operations: %'lu\n", fpOps);
+	for (i = 0; i < numSlabClasses; i++) {
+		VG_(dmsg)("DEBUG - ShadowValues (%ld bit): %'lu in use, max: %'lu, slabs: %'lu (%'lu KB)\n", slabClasses[i].prec, 
+			slabClasses[i].inUse, slabClasses[i].maxInUse, slabClasses[i].slabs, (slabClasses[i].slabs * SLAB_SIZE) / 1024);
+	}
+	VG_(dmsg)("DEBUG - ShadowValues (locations): %'lu in use, max: %'lu, slabs: %'lu (%'lu KB), copies shared: %'lu\n", 
+		locationSlab.inUse, locationSlab.maxInUse, locationSlab.slabs, (locationSlab.slabs * SLAB_SIZE) / 1024, sharedCopies);
+	VG_(dmsg)("DEBUG - Cold metadata: %'u shadow data, %'u shadow values (%'lu KB)\n", dataColdArray.used, valueColdArray.used,
+		(dataColdArray.size * dataColdArray.elemSize + valueColdArray.size * valueColdArray.elemSize) / 1024);
+	VG_(dmsg)("DEBUG - Shadow memory: %'lu values in %'lu secondary maps (%'lu KB)\n", 
+		shadowMemCount, secMapCount, (secMapCount * sizeof(ShadowSecMap)) / 1024);
+	VG_(dmsg)("DEBUG - Shadow values in use: %'lu KB, evicted: %'lu, dropped: %'lu, copied: %'lu\n", 
+		shadowBytes / 1024, shadowEvicted, shadowDropped, shadowCopied);
+	VG_(dmsg)("DEBUG - Floating-point operations: %'lu, native without MPFR: %'lu\n", fpOps, exactOps);
 	VG_(dmsg)("DEBUG - Max temps: %'u\n", maxTemps);
+	if (clo_exactSums) {
+		VG_(dmsg)("DEBUG - Exact sums: %'lu operations, in place: %'lu, accumulators in use: %'lu, max: %'lu\n",
+			accOps, accInPlace, accSlab.inUse, accSlab.maxInUse);
+	}
+	VG_(dmsg)("OPTIMIZATION - SB:    total %'lu, integer: %'u, move: %'u\n", sbCounter, intBlocks, moveBlocks);
 	VG_(dmsg)("OPTIMIZATION - GET:   total %'u, ignored: %'u\n", getCount, getsIgnored);
 	VG_(dmsg)("OPTIMIZATION - STORE: total %'u, ignored: %'u\n", storeCount, storesIgnored);
 	VG_(dmsg)("OPTIMIZATION - PUT:   total %'u, ignored: %'u\n", putCount, putsIgnored);
@@ -3512,6 +6119,9 @@ static Bool fd_handle_client_request(ThreadId tid, UWord* arg, UWord* ret) {
 		case VG_USERREQ__END:
 			endAnalyzing();
 			break;
+		case VG_USERREQ__COPY_MEMORY:
+			*ret = (UWord)copyMemory(arg[1], arg[2], arg[3]);
+			return True;
 	}
 	return False;
 }
@@ -3528,8 +6138,205 @@ static void gmp_free(void* p, size_t t) {
 	VG_(free)(p);
 }
 
+static void dieMem(Addr a, SizeT len) {
+	dropShadowRange(a, len);
+}
+
+static void postMemWrite(CorePart part, ThreadId tid, Addr a, SizeT len) {
+	dropShadowRange(a, len);
+}
+
+/* Called for every dead stack frame, e.g. on each function return. The fixed 
+   size variants are called directly from the generated code. */
+static VG_REGPARM(1) void dieMemStack4(Addr a) {
+	dropShadowRange(a, 4);
+}
+
+static VG_REGPARM(1) void dieMemStack8(Addr a) {
+	dropShadowRange(a, 8);
+}
+
+static VG_REGPARM(1) void dieMemStack16(Addr a) {
+	dropShadowRange(a, 16);
+}
+
+static VG_REGPARM(1) void dieMemStack32(Addr a) {
+	dropShadowRange(a, 32);
+}
+
+/* The heap of the client is replaced, so that the shadow values of a block are
+   dropped when it is freed. Otherwise they would be picked up again when the 
+   memory is reused. */
+static void* newBlock(SizeT szB, SizeT align, Bool zero) {
+	if ((SSizeT)szB < 0) {
+		return NULL;
+	}
+	void* p = VG_(cli_malloc)(align, szB);
+	if (!p) {
+		return NULL;
+	}
+	if (zero) {
+		VG_(memset)(p, 0, szB);
+	}
+
+	HeapBlock* hb = VG_(malloc)("fd.newBlock.1", sizeof(HeapBlock));
+	hb->key = (UWord)p;
+	hb->szB = szB;
+	VG_(HT_add_node)(heapBlocks, hb);
+	return p;
+}
+
+static void freeBlock(void* p) {
+	HeapBlock* hb = VG_(HT_remove)(heapBlocks, (UWord)p);
+	if (!hb) {
+		/* invalid or double free, there is nothing to drop */
+		return;
+	}
+	dropShadowRange((Addr)p, hb->szB);
+	VG_(cli_free)(p);
+	VG_(free)(hb);
+}
+
+static void* fd_malloc(ThreadId tid, SizeT szB) {
+	return newBlock(szB, VG_(clo_alignment), False);
+}
+
+static void* fd___builtin_new(ThreadId tid, SizeT szB) {
+	return newBlock(szB, VG_(clo_alignment), False);
+}
+
+static void* fd___builtin_vec_new(ThreadId tid, SizeT szB) {
+	return newBlock(szB, VG_(clo_alignment), False);
+}
+
+static void* fd_memalign(ThreadId tid, SizeT align, SizeT szB) {
+	return newBlock(szB, align, False);
+}
+
+static void* fd_calloc(ThreadId tid, SizeT nmemb, SizeT size1) {
+	/* check for overflow of nmemb * size1 */
+	if (size1 > 0 && nmemb > ((SizeT)-1) / size1) {
+		return NULL;
+	}
+	return newBlock(nmemb * size1, VG_(clo_alignment), True);
+}
+
+static void fd_free(ThreadId tid, void* p) {
+	freeBlock(p);
+}
+
+static void fd___builtin_delete(ThreadId tid, void* p) {
+	freeBlock(p);
+}
+
+static void fd___builtin_vec_delete(ThreadId tid, void* p) {
+	freeBlock(p);
+}
+
+static void* fd_realloc(ThreadId tid, void* p, SizeT newSzB) {
+	if ((SSizeT)newSzB < 0) {
+		return NULL;
+	}
+	HeapBlock* hb = VG_(HT_lookup)(heapBlocks, (UWord)p);
+	if (!hb) {
+		return NULL;
+	}
+
+	void* newP = VG_(cli_malloc)(VG_(clo_alignment), newSzB);
+	if (!newP) {
+		return NULL;
+	}
+	VG_(memcpy)(newP, p, newSzB < hb->szB ? newSzB : hb->szB);
+
+	VG_(HT_remove)(heapBlocks, (UWord)p);
+	copyShadowRange((Addr)p, (Addr)newP, newSzB < hb->szB ? newSzB : hb->szB);
+	dropShadowRange((Addr)p, hb->szB);
+	VG_(cli_free)(p);
+
+	hb->key = (UWord)newP;
+	hb->szB = newSzB;
+	VG_(HT_add_node)(heapBlocks, hb);
+	return newP;
+}
+
+static SizeT fd_malloc_usable_size(ThreadId tid, void* p) {
+	HeapBlock* hb = VG_(HT_lookup)(heapBlocks, (UWord)p);
+	return hb ? hb->szB : 0;
+}
+
 static void fd_post_clo_init(void) {
-	VG_(umsg)("precision=%ld\n", clo_precision);
+	if (clo_shadowBackend != Sb_MPFR && clo_simulateOriginal) {
+		VG_(umsg)("sim-original computes natively, shadow-backend is not used\n");
+		clo_shadowBackend = Sb_MPFR;
+	}
+	if (clo_adaptivePrecision && (clo_shadowBackend != Sb_MPFR || clo_simulateOriginal || clo_precision < 106)) {
+		VG_(umsg)("adaptive-precision needs MPFR with a precision of at least 106, it is not used\n");
+		clo_adaptivePrecision = False;
+	}
+	if (clo_precisionFile && (clo_shadowBackend != Sb_MPFR || clo_simulateOriginal || clo_adaptivePrecision)) {
+		VG_(umsg)("precision-file needs MPFR for all shadow values, it is not used\n");
+		clo_precisionFile = NULL;
+	}
+	if (clo_checkPrecision > 0 && (clo_shadowBackend != Sb_MPFR || clo_simulateOriginal || clo_adaptivePrecision)) {
+		VG_(umsg)("a second precision needs MPFR for all shadow values, it is not used\n");
+		clo_checkPrecision = 0;
+	}
+	if (clo_exactSums && (clo_shadowBackend != Sb_MPFR || clo_simulateOriginal || clo_adaptivePrecision ||
+		clo_checkPrecision > 0))
+	{
+		VG_(umsg)("exact-sums needs MPFR for all shadow values and no second precision, it is not used\n");
+		clo_exactSums = False;
+	}
+	switch (clo_shadowBackend) {
+		case Sb_DD:
+			shadowParts = 2;
+			clo_precision = 106;
+			break;
+		case Sb_QD:
+			shadowParts = 4;
+			clo_precision = 212;
+			break;
+		case Sb_F128:
+			shadowParts = 2;
+			clo_precision = 113;
+#if defined(FD_HAVE_F128)
+			partsOps = &f128Ops;
+#endif
+			break;
+		case Sb_STOCH:
+			/* the samples need the space of the limbs */
+			shadowParts = clo_samples;
+			clo_precision = 53 * clo_samples;
+			partsOps = &stochOps;
+			break;
+		case Sb_COND:
+			shadowParts = 2;
+			clo_precision = 106;
+			partsOps = &condOps;
+			break;
+		default:
+			/* values start as double-double */
+			if (clo_adaptivePrecision) {
+				shadowParts = 2;
+			}
+			break;
+	}
+	/* the parts are replaced by the limbs */
+	tl_assert(shadowParts * sizeof(Double) <= mpfr_custom_get_size(clo_precision));
+
+	maxPrecision = shadowPrec();
+	if (clo_precisionFile) {
+		readPrecisionFile(clo_precisionFile);
+	}
+
+	if (clo_checkPrecision > 0) {
+		VG_(umsg)("precision=%ld,%ld\n", clo_precision, clo_checkPrecision);
+	} else {
+		VG_(umsg)("precision=%ld\n", clo_precision);
+	}
+	if (clo_precisionFile) {
+		VG_(umsg)("precision-file=%s\n", clo_precisionFile);
+	}
 	VG_(umsg)("mean-error=%s\n", clo_computeMeanValue ? "yes" : "no");
 	VG_(umsg)("ignore-libraries=%s\n", clo_ignoreLibraries ? "yes" : "no");
 	VG_(umsg)("ignore-accurate=%s\n", clo_ignoreAccurate ? "yes" : "no");
@@ -3537,18 +6344,29 @@ static void fd_post_clo_init(void) {
 	VG_(umsg)("analyze-all=%s\n", clo_analyze ? "yes" : "no");
 	VG_(umsg)("bad-cancellations=%s\n", clo_bad_cancellations ? "yes" : "no");
     VG_(umsg)("ignore-end=%s\n", clo_ignore_end ? "yes" : "no");	
+	VG_(umsg)("max-shadow-mb=%ld\n", clo_max_shadow_mb);
+	VG_(umsg)("shadow-backend=%s\n", clo_shadowBackend == Sb_DD ? "dd" : (clo_shadowBackend == Sb_QD ? "qd" :
+		(clo_shadowBackend == Sb_F128 ? "f128" : (clo_shadowBackend == Sb_STOCH ? "stochastic" :
+		(clo_shadowBackend == Sb_COND ? "condition" : "mpfr")))));
+	if (clo_shadowBackend == Sb_STOCH) {
+		VG_(umsg)("samples=%d\n", clo_samples);
+	}
+	VG_(umsg)("adaptive-precision=%s\n", clo_adaptivePrecision ? "yes" : "no");
+	VG_(umsg)("exact-sums=%s\n", clo_exactSums ? "yes" : "no");
+	VG_(umsg)("skip-int-blocks=%s\n", clo_skipIntBlocks ? "yes" : "no");
 
 	mpfr_set_default_prec(clo_precision);
 
-	globalMemory = VG_(HT_construct)("Global memory");
+	initSlabClass(&locationSlab, 0, sizeof(ShadowValue));
+	initSlabClass(&accSlab, 0, sizeof(Accumulator));
+	auxSecMaps = VG_(HT_construct)("Auxiliary secondary maps");
+	shadowEvictions = VG_(HT_construct)("Shadow evictions");
+	promotedSites = VG_(HT_construct)("Promoted sites");
+	laneSites = VG_(HT_construct)("Lane sites");
+	accSites = VG_(HT_construct)("Accumulation sites");
+	heapBlocks = VG_(HT_construct)("Heap blocks");
 	meanValues = VG_(HT_construct)("Mean values");
-
-	storeArgs = VG_(malloc)("fd.init.1", sizeof(Store));
-	muxArgs = VG_(malloc)("fd.init.2", sizeof(Mux0X));
-	unOpArgs = VG_(malloc)("fd.init.3", sizeof(UnOp));
-	binOpArgs = VG_(malloc)("fd.init.4", sizeof(BinOp));
-	triOpArgs = VG_(malloc)("fd.init.5", sizeof(TriOp));
-	circRegs = VG_(malloc)("fd.init.6", sizeof(CircularRegs));
+	opDescs = VG_(HT_construct)("Operation descriptors");
 
 	mpfr_inits(meanOrg, meanRelError, NULL);
 	mpfr_inits(stageOrg, stageDiff, stageRelError, NULL);
@@ -3559,24 +6377,17 @@ static void fd_post_clo_init(void) {
 	mpfr_inits(compareIntroErr1, compareIntroErr2, NULL);
 	mpfr_inits(writeSvOrg, writeSvDiff, writeSvRelError, NULL);
 	mpfr_init(cancelTemp);
-	mpfr_inits(arg1tmpX, arg2tmpX, arg3tmpX, NULL);
-
-	Int i;
-	for (i = 0; i < TMP_COUNT; i++) {
-		sTmp[i] = VG_(malloc)("fd.init.7", sizeof(ShadowTmp));
-		sTmp[i]->U128 = VG_(malloc)("fd.init.8", sizeof(UInt) * 4);	/* 128bit */
+	mpfr_init(partsTemp);
+	mpfr_inits2(maxPrecision, arg1tmpX, arg2tmpX, arg3tmpX, NULL);
+	if (clo_exactSums) {
+		mpfr_init2(accTemp, ACC_WORDS * 64);
+		mpfr_init2(accValue, maxPrecision);
 	}
-
-	for (i = 0; i < CONST_COUNT; i++) {
-		sConst[i] = VG_(malloc)("fd.init.9", sizeof(ShadowTmp));
+	if (clo_checkPrecision > 0) {
+		mpfr_inits2(clo_checkPrecision, arg1laneX, arg2laneX, arg3laneX, laneRelError, NULL);
 	}
 
-	Int j;
-	for (i = 0; i < VG_N_THREADS; i++) {
-		for (j = 0; j < MAX_REGISTERS; j++) {
-			threadRegisters[i][j] = NULL;
-		}
-	}
+	Int i;
 	for (i = 0; i < MAX_TEMPS; i++) {
 		localTemps[i] = NULL;
 	}
@@ -3606,6 +6417,32 @@ static void fd_pre_clo_init(void) {
 	
 	VG_(needs_client_requests)   (fd_handle_client_request);
 
+	VG_(needs_malloc_replacement)(fd_malloc,
+								fd___builtin_new,
+								fd___builtin_vec_new,
+								fd_memalign,
+								fd_calloc,
+								fd_free,
+								fd___builtin_delete,
+								fd___builtin_vec_delete,
+								fd_realloc,
+								fd_malloc_usable_size,
+								0);
+
+	/* shadow values of memory that is released or overwritten by the kernel are dropped */
+	VG_(track_die_mem_brk)       (dieMem);
+	VG_(track_die_mem_munmap)    (dieMem);
+	VG_(track_post_mem_write)    (postMemWrite);
+	VG_(track_die_mem_stack_signal)(dieMem);
+	VG_(track_die_mem_stack)     (dieMem);
+	VG_(track_die_mem_stack_4)   (dieMemStack4);
+	VG_(track_die_mem_stack_8)   (dieMemStack8);
+	VG_(track_die_mem_stack_16)  (dieMemStack16);
+	VG_(track_die_mem_stack_32)  (dieMemStack32);
+	VG_(track_pre_thread_first_insn)(threadFirstInsn);
+	VG_(track_pre_thread_ll_exit)(threadExit);
+	VG_(track_pre_deliver_signal)(preDeliverSignal);
+
 	/* Calls to C library functions in GMP and MPFR have to be replaced with the Valgrind versions.
 	   The function mp_set_memory_functions is part of GMP and thus MPFR, all others have been added 
 	   to MPFR. Therefore, this only works with pateched versions of GMP and MPFR. */
@@ -0,0 +1,495 @@
+
+/*--------------------------------------------------------------------*/
+/*--- Double-double and quad-double arithmetic for FpDebug.        ---*/
+/*---                                                      fd_qd.c ---*/
+/*--------------------------------------------------------------------*/
+
+/*
+   This file is part of FpDebug, a heavyweight Valgrind tool for
+   detecting floating-point accuracy problems.
+
+   Copyright (C) 2010-2011 Florian Benz
+      florianbenz1@gmail.com
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2 of the
+   License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+   02111-1307, USA.
+
+   The GNU General Public License is contained in the file COPYING.
+*/
+
+/*
+   A double-double (2 parts, 106 bits) or quad-double (4 parts, 212 bits)
+   is an unevaluated sum of doubles, ordered by decreasing magnitude and
+   without overlapping bits. The algorithms follow the QD library of Hida,
+   Li and Bailey and only use native double arithmetic, which is done with
+   SSE2 on amd64. The operations work on arrays of parts, the number of
+   parts n is 2 or 4.
+   Infinity and NaN are only kept in the first part, the others are zero.
+   The error-free transformations (twoSumErr, twoProdErr and the
+   remainders) need every operation rounded on its own. A product
+   contracted into an FMA makes the error terms zero, so the tool is built
+   with -ffp-contract=off (see Makefile.am). The stochastic and the
+   condition backend take their rounding errors from here as well.
+*/
+
+#define QD_MAX_PARTS		4
+/* products above this bound would overflow in splitDouble */
+#define QD_SPLIT_THRESH		6.69692879491417e+299
+
+static __inline__
+Bool isFiniteDouble(Double x) {
+	ULong bits = *(ULong*)&x;
+	return ((bits >> 52) & 0x7FF) != 0x7FF;
+}
+
+/* neither zero nor subnormal nor infinity nor NaN */
+static __inline__
+Bool isRegularDouble(Double x) {
+	ULong bits = *(ULong*)&x;
+	UInt e = (UInt)((bits >> 52) & 0x7FF);
+	return e != 0 && e != 0x7FF;
+}
+
+/* exponent as returned by mpfr_get_exp, only for normal numbers */
+static __inline__
+Long nativeExp(Double x) {
+	ULong bits = *(ULong*)&x;
+	return (Long)((bits >> 52) & 0x7FF) - 1022;
+}
+
+/* True if the minimum of a and b, or the maximum with max, is a. c
+   compares a and b like qdCmp and is not used if one of them is NaN.
+   NaN is only returned if both are NaN, like in mpfr_min and mpfr_max. */
+static __inline__
+Bool minMaxIsFirst(Bool aIsNaN, Bool bIsNaN, Int c, Bool max) {
+	if (bIsNaN) {
+		return True;
+	}
+	if (aIsNaN) {
+		return False;
+	}
+	return max ? c >= 0 : c <= 0;
+}
+
+static __inline__
+Bool minMaxIsFirstDouble(Double a, Double b, Bool max) {
+	return minMaxIsFirst(a != a, b != b, (a > b) - (a < b), max);
+}
+
+/* number of leading zero bits of x, which is not zero */
+static __inline__
+Int leadingZeros(ULong x) {
+	return __builtin_clzll(x);
+}
+
+static __inline__
+Double absDouble(Double x) {
+	return x < 0 ? -x : x;
+}
+
+/* the tool is not linked against libm */
+static __inline__
+Double sqrtDouble(Double x) {
+#if defined(VGA_amd64)
+	Double r;
+	__asm__("sqrtsd %1, %0" : "=x" (r) : "x" (x));
+	return r;
+#else
+	Int i;
+	if (!(x > 0) || !isFiniteDouble(x)) {
+		return x == 0 || x > 0 ? x : (x - x) / (x - x);
+	}
+	Double r = x > 1 ? x : 1;
+	for (i = 0; i < 1100; i++) {
+		Double next = 0.5 * (r + x / r);
+		if (next >= r) {
+			break;
+		}
+		r = next;
+	}
+	return r;
+#endif
+}
+
+/* error-free transformations: a + b = s + err and a * b = p + err */
+static __inline__
+Double twoSumErr(Double a, Double b, Double s) {
+	Double bb = s - a;
+	return (a - (s - bb)) + (b - bb);
+}
+
+/* only if |a| >= |b| */
+static __inline__
+Double quickTwoSumErr(Double a, Double b, Double s) {
+	return b - (s - a);
+}
+
+static __inline__
+void splitDouble(Double a, Double* hi, Double* lo) {
+	/* 2^27 + 1 */
+	Double t;
+	if (a > QD_SPLIT_THRESH || a < -QD_SPLIT_THRESH) {
+		/* scaled by 2^-28 and 2^28 */
+		a *= 3.7252902984619140625e-09;
+		t = 134217729.0 * a;
+		*hi = t - (t - a);
+		*lo = a - *hi;
+		*hi *= 268435456.0;
+		*lo *= 268435456.0;
+	} else {
+		t = 134217729.0 * a;
+		*hi = t - (t - a);
+		*lo = a - *hi;
+	}
+}
+
+static __inline__
+Double twoProdErr(Double a, Double b, Double p) {
+	Double ah, al, bh, bl;
+	splitDouble(a, &ah, &al);
+	splitDouble(b, &bh, &bl);
+	return ((ah * bh - p) + ah * bl + al * bh) + al * bl;
+}
+
+/* The remainder a - q * b of the quotient q = a / b rounded to nearest,
+   computed exactly. It is zero if q is exact, otherwise the error of q is
+   the remainder divided by b. Zero if q or b is infinite or NaN or b is
+   zero. */
+static __inline__
+Double divRemainder(Double a, Double b, Double q) {
+	if (!isFiniteDouble(q) || b == 0 || !isFiniteDouble(b)) {
+		return 0;
+	}
+	Double p = q * b;
+	return (a - p) - twoProdErr(q, b, p);
+}
+
+/* The remainder a - s * s of the square root s of a, like divRemainder.
+   The error of s is about the remainder divided by 2 * s. Zero if s is
+   zero, infinite or NaN. */
+static __inline__
+Double sqrtRemainder(Double a, Double s) {
+	if (!(s > 0) || !isFiniteDouble(s)) {
+		return 0;
+	}
+	Double p = s * s;
+	return (a - p) - twoProdErr(s, s, p);
+}
+
+/* Sums m terms, roughly ordered by decreasing magnitude, into n
+   non-overlapping parts. The terms are overwritten. */
+static void qdRenorm(Double* t, Int m, Double* r, Int n) {
+	Int i, j;
+	Double s, hi, lo;
+
+	if (!isFiniteDouble(t[0])) {
+		r[0] = t[0];
+		for (i = 1; i < m; i++) {
+			r[0] += t[i];
+		}
+		for (j = 1; j < n; j++) {
+			r[j] = 0;
+		}
+		return;
+	}
+
+	/* bottom up, afterwards t[0] is close to the sum */
+	for (i = m - 1; i > 0; i--) {
+		hi = t[i - 1] + t[i];
+		t[i] = twoSumErr(t[i - 1], t[i], hi);
+		t[i - 1] = hi;
+	}
+
+	/* top down, zero errors are skipped so that the parts do not overlap */
+	s = t[0];
+	j = 0;
+	for (i = 1; i < m && j < n - 1; i++) {
+		hi = s + t[i];
+		lo = twoSumErr(s, t[i], hi);
+		if (lo != 0) {
+			r[j++] = hi;
+			s = lo;
+		} else {
+			s = hi;
+		}
+	}
+	for (; i < m; i++) {
+		s += t[i];
+	}
+	r[j++] = s;
+	for (; j < n; j++) {
+		r[j] = 0;
+	}
+}
+
+static __inline__
+void qdSetSpecial(Int n, Double x, Double* r) {
+	Int i;
+	r[0] = x;
+	for (i = 1; i < n; i++) {
+		r[i] = 0;
+	}
+}
+
+static __inline__
+void qdNeg(Int n, const Double* a, Double* r) {
+	Int i;
+	for (i = 0; i < n; i++) {
+		r[i] = -a[i];
+	}
+}
+
+static __inline__
+void qdAbs(Int n, const Double* a, Double* r) {
+	Int i;
+	if (a[0] < 0) {
+		qdNeg(n, a, r);
+	} else {
+		for (i = 0; i < n; i++) {
+			r[i] = a[i];
+		}
+	}
+}
+
+/* r = a + b, the parts of a and b are merged by magnitude */
+static void qdAddSorted(Int n, const Double* a, const Double* b, Double* r) {
+	Double t[2 * QD_MAX_PARTS];
+	Int i = 0, j = 0, k = 0;
+
+	while (i < n && j < n) {
+		if (absDouble(a[i]) >= absDouble(b[j])) {
+			t[k++] = a[i++];
+		} else {
+			t[k++] = b[j++];
+		}
+	}
+	while (i < n) t[k++] = a[i++];
+	while (j < n) t[k++] = b[j++];
+
+	qdRenorm(t, k, r, n);
+}
+
+/* double-double addition that stays accurate under cancellation */
+static __inline__
+void ddAdd(const Double* a, const Double* b, Double* r) {
+	Double s1, s2, t1, t2;
+	s1 = a[0] + b[0];
+	s2 = twoSumErr(a[0], b[0], s1);
+	t1 = a[1] + b[1];
+	t2 = twoSumErr(a[1], b[1], t1);
+	s2 += t1;
+	t1 = s1 + s2;
+	s2 = quickTwoSumErr(s1, s2, t1);
+	s2 += t2;
+	r[0] = t1 + s2;
+	r[1] = quickTwoSumErr(t1, s2, r[0]);
+}
+
+static void qdAdd(Int n, const Double* a, const Double* b, Double* r) {
+	if (!isFiniteDouble(a[0]) || !isFiniteDouble(b[0])) {
+		qdSetSpecial(n, a[0] + b[0], r);
+	} else if (n == 2) {
+		ddAdd(a, b, r);
+	} else {
+		qdAddSorted(n, a, b, r);
+	}
+	if (!isFiniteDouble(r[0])) {
+		qdSetSpecial(n, r[0], r);
+	}
+}
+
+static void qdSub(Int n, const Double* a, const Double* b, Double* r) {
+	Double nb[QD_MAX_PARTS];
+	qdNeg(n, b, nb);
+	qdAdd(n, a, nb, r);
+}
+
+/* r = a * b for a double b */
+static void qdMulD(Int n, const Double* a, Double b, Double* r) {
+	Double t[2 * QD_MAX_PARTS];
+	Double p[QD_MAX_PARTS];
+	Int i, m = 0;
+
+	if (n == 2) {
+		Double e;
+		p[0] = a[0] * b;
+		e = twoProdErr(a[0], b, p[0]) + a[1] * b;
+		r[0] = p[0] + e;
+		r[1] = quickTwoSumErr(p[0], e, r[0]);
+		return;
+	}
+
+	/* the error of a part has the magnitude of the next part */
+	for (i = 0; i < n; i++) {
+		p[i] = a[i] * b;
+	}
+	t[m++] = p[0];
+	for (i = 1; i < n; i++) {
+		t[m++] = p[i];
+		t[m++] = twoProdErr(a[i - 1], b, p[i - 1]);
+	}
+	t[m++] = twoProdErr(a[n - 1], b, p[n - 1]);
+	qdRenorm(t, m, r, n);
+}
+
+static __inline__
+void ddMul(const Double* a, const Double* b, Double* r) {
+	Double p = a[0] * b[0];
+	Double e = twoProdErr(a[0], b[0], p) + (a[0] * b[1] + a[1] * b[0]);
+	r[0] = p + e;
+	r[1] = quickTwoSumErr(p, e, r[0]);
+}
+
+/* The products a[i] * b[j] with i + j < n are computed exactly, the ones
+   with i + j == n without their error. They are ordered by i + j, which
+   is roughly by magnitude. */
+static void qdMulSorted(Int n, const Double* a, const Double* b, Double* r) {
+	Double t[4 * QD_MAX_PARTS * QD_MAX_PARTS];
+	Double err[QD_MAX_PARTS * QD_MAX_PARTS];
+	Int level, i, m = 0, e = 0, eStart = 0;
+
+	for (level = 0; level <= n; level++) {
+		Int eEnd = e;
+		for (i = 0; i <= level; i++) {
+			if (i >= n || level - i >= n) {
+				continue;
+			}
+			Double p = a[i] * b[level - i];
+			t[m++] = p;
+			if (level < n) {
+				err[e++] = twoProdErr(a[i], b[level - i], p);
+			}
+		}
+		/* the errors of the previous level */
+		for (i = eStart; i < eEnd; i++) {
+			t[m++] = err[i];
+		}
+		eStart = eEnd;
+	}
+	qdRenorm(t, m, r, n);
+}
+
+static void qdMul(Int n, const Double* a, const Double* b, Double* r) {
+	if (!isFiniteDouble(a[0]) || !isFiniteDouble(b[0])) {
+		qdSetSpecial(n, a[0] * b[0], r);
+	} else if (n == 2) {
+		ddMul(a, b, r);
+	} else {
+		qdMulSorted(n, a, b, r);
+	}
+	if (!isFiniteDouble(r[0])) {
+		qdSetSpecial(n, r[0], r);
+	}
+}
+
+/* long division, each quotient adds the bits of one part */
+static void qdDiv(Int n, const Double* a, const Double* b, Double* r) {
+	Double q[QD_MAX_PARTS + 1];
+	Double rem[QD_MAX_PARTS];
+	Double prod[QD_MAX_PARTS];
+	Int i;
+
+	if (!isFiniteDouble(a[0]) || !isFiniteDouble(b[0]) || b[0] == 0 || a[0] == 0) {
+		qdSetSpecial(n, a[0] / b[0], r);
+		return;
+	}
+
+	for (i = 0; i < n; i++) {
+		rem[i] = a[i];
+	}
+	for (i = 0; i <= n; i++) {
+		q[i] = rem[0] / b[0];
+		if (i < n) {
+			qdMulD(n, b, q[i], prod);
+			qdSub(n, rem, prod, rem);
+		}
+	}
+	qdRenorm(q, n + 1, r, n);
+	if (!isFiniteDouble(r[0])) {
+		qdSetSpecial(n, r[0], r);
+	}
+}
+
+/* Newton iteration s = s + (a - s^2) / 2s, each step adds about 53 bits */
+static void qdSqrt(Int n, const Double* a, Double* r) {
+	Double sq[QD_MAX_PARTS];
+	Double corr[QD_MAX_PARTS];
+	Int i;
+
+	if (!isFiniteDouble(a[0]) || a[0] <= 0) {
+		qdSetSpecial(n, sqrtDouble(a[0]), r);
+		return;
+	}
+
+	qdSetSpecial(n, sqrtDouble(a[0]), r);
+	for (i = 0; i < n; i++) {
+		qdMul(n, r, r, sq);
+		qdSub(n, a, sq, sq);
+		qdSetSpecial(n, sq[0] / (2 * r[0]), corr);
+		qdAdd(n, r, corr, r);
+	}
+}
+
+/* like mpfr_cmp, NaN is treated as equal */
+static Int qdCmp(Int n, const Double* a, const Double* b) {
+	Int i;
+	for (i = 0; i < n; i++) {
+		if (a[i] < b[i]) {
+			return -1;
+		} else if (a[i] > b[i]) {
+			return 1;
+		}
+	}
+	return 0;
+}
+
+static void qdMinMax(Int n, const Double* a, const Double* b, Bool max, Double* r) {
+	const Double* m = minMaxIsFirst(a[0] != a[0], b[0] != b[0], qdCmp(n, a, b), max) ? a : b;
+	Int i;
+
+	for (i = 0; i < n; i++) {
+		r[i] = m[i];
+	}
+}
+
+/* The operations of qdOps. The parts are not rounded to the precision
+   of the original operation, so isFloat is not used. */
+static void qdAddOp(Int n, Bool isFloat, const Double* a, const Double* b, Double* r) {
+	qdAdd(n, a, b, r);
+}
+
+static void qdSubOp(Int n, Bool isFloat, const Double* a, const Double* b, Double* r) {
+	qdSub(n, a, b, r);
+}
+
+static void qdMulOp(Int n, Bool isFloat, const Double* a, const Double* b, Double* r) {
+	qdMul(n, a, b, r);
+}
+
+static void qdDivOp(Int n, Bool isFloat, const Double* a, const Double* b, Double* r) {
+	qdDiv(n, a, b, r);
+}
+
+static void qdSqrtOp(Int n, Bool isFloat, const Double* a, Double* r) {
+	qdSqrt(n, a, r);
+}
+
+static const PartsOps qdOps = {
+	qdSetSpecial, qdAddOp, qdSubOp, qdMulOp, qdDivOp, qdSqrtOp, qdNeg, qdAbs, qdMinMax
+};
+
+/*--------------------------------------------------------------------*/
+/*--- end                                                          ---*/
+/*--------------------------------------------------------------------*/
@@ -0,0 +1,121 @@
+
+/*--------------------------------------------------------------------*/
+/*--- Replacements for memcpy and memmove.   fd_replace_strmem.c ---*/
+/*--------------------------------------------------------------------*/
+
+/*
+   This file is part of FpDebug, a heavyweight Valgrind tool for
+   detecting floating-point accuracy problems.
+
+   Copyright (C) 2010-2011 Florian Benz
+      florianbenz1@gmail.com
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2 of the
+   License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+   02111-1307, USA.
+
+   The GNU General Public License is contained in the file COPYING.
+*/
+
+/*
+   This file is part of vgpreload_fpdebug-<platform>.so and runs on the
+   simulated CPU. The client's memcpy and memmove are redirected to the
+   functions below. They ask FpDebug to copy the data together with the
+   shadow values of the range, so that copies of floating-point arrays
+   keep their shadow values. Copied word by word on the simulated CPU, the
+   shadow values would be lost as the copy does not go through
+   floating-point loads and stores, and every word would call the helpers.
+   Only if FpDebug cannot access a range, the data is copied here.
+*/
+
+#include "pub_tool_basics.h"
+#include "pub_tool_redir.h"
+
+#include "fpdebug.h"
+
+static __inline__
+void copyBytes(void* dst, const void* src, SizeT len) {
+	if (dst == src || len == 0) {
+		return;
+	}
+
+	if (((Addr)dst | (Addr)src | len) % sizeof(UWord) == 0) {
+		UWord* d = (UWord*)dst;
+		const UWord* s = (const UWord*)src;
+		SizeT n = len / sizeof(UWord);
+		if (d < s) {
+			while (n-- > 0) *d++ = *s++;
+		} else {
+			d += n;
+			s += n;
+			while (n-- > 0) *--d = *--s;
+		}
+	} else {
+		UChar* d = (UChar*)dst;
+		const UChar* s = (const UChar*)src;
+		if (d < s) {
+			while (len-- > 0) *d++ = *s++;
+		} else {
+			d += len;
+			s += len;
+			while (len-- > 0) *--d = *--s;
+		}
+	}
+}
+
+static __inline__
+void my_exit(int x) {
+	extern __attribute__ ((__noreturn__)) void _exit(int status);
+	_exit(x);
+}
+
+/* both copies handle overlapping ranges, so memcpy and memmove are the same */
+#define MEMMOVE_OR_MEMCPY(soname, fnname) \
+	void* VG_REPLACE_FUNCTION_ZU(soname, fnname)(void* dst, const void* src, SizeT len); \
+	void* VG_REPLACE_FUNCTION_ZU(soname, fnname)(void* dst, const void* src, SizeT len) { \
+		if (!VALGRIND_COPY_MEMORY(dst, src, len)) { \
+			copyBytes(dst, src, len); \
+		} \
+		return dst; \
+	}
+
+/* like glibc, the fortified versions abort if the destination is too small */
+#define MEMMOVE_OR_MEMCPY_CHK(soname, fnname) \
+	void* VG_REPLACE_FUNCTION_ZU(soname, fnname)(void* dst, const void* src, SizeT len, SizeT dstlen); \
+	void* VG_REPLACE_FUNCTION_ZU(soname, fnname)(void* dst, const void* src, SizeT len, SizeT dstlen) { \
+		if (dstlen < len) { \
+			VALGRIND_PRINTF_BACKTRACE("*** " #fnname ": buffer overflow detected ***: " \
+				"program terminated\n"); \
+			my_exit(127); \
+		} \
+		if (!VALGRIND_COPY_MEMORY(dst, src, len)) { \
+			copyBytes(dst, src, len); \
+		} \
+		return dst; \
+	}
+
+MEMMOVE_OR_MEMCPY(VG_Z_LIBC_SONAME, memcpy)
+MEMMOVE_OR_MEMCPY(VG_Z_LIBC_SONAME, memmove)
+MEMMOVE_OR_MEMCPY_CHK(VG_Z_LIBC_SONAME, __memcpy_chk)
+MEMMOVE_OR_MEMCPY_CHK(VG_Z_LIBC_SONAME, __memmove_chk)
+
+#if defined(VGO_linux)
+/* the dynamic linker has its own memcpy, which is used before libc is loaded */
+MEMMOVE_OR_MEMCPY(VG_Z_LD_SO_1, memcpy)
+MEMMOVE_OR_MEMCPY(VG_Z_LD64_SO_1, memcpy)
+#endif
+
+/*--------------------------------------------------------------------*/
+/*--- end                                                          ---*/
+/*--------------------------------------------------------------------*/
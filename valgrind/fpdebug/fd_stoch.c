@@ -0,0 +1,230 @@
+
+/*--------------------------------------------------------------------*/
+/*--- Stochastic arithmetic for FpDebug.               fd_stoch.c ---*/
+/*--------------------------------------------------------------------*/
+
+/*
+   This file is part of FpDebug, a heavyweight Valgrind tool for
+   detecting floating-point accuracy problems.
+
+   Copyright (C) 2010-2011 Florian Benz
+      florianbenz1@gmail.com
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2 of the
+   License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+   02111-1307, USA.
+
+   The GNU General Public License is contained in the file COPYING.
+*/
+
+/*
+   Random rounding like in CADNA: a shadow value is kept as n samples of
+   the original computation (n is 2 to 4), each of them computed in the
+   precision of the original operation, but rounded up or down at random
+   instead of to nearest. The error-free transformations of fd_qd.c give
+   the direction of the exact result. The spread of the samples estimates
+   the number of significant digits of the original value.
+   The random bits come from a xorshift generator with a fixed seed, so
+   runs can be repeated.
+*/
+
+static ULong stochState		= 0x9E3779B97F4A7C15ULL;
+static ULong stochBits		= 0;
+static Int stochBitsLeft	= 0;
+
+/* Student's t for 95% and n - 1 degrees of freedom */
+static const Double stochStudentT[QD_MAX_PARTS + 1] = { 0, 0, 12.706, 4.303, 3.182 };
+
+static __inline__
+Bool stochCoin(void) {
+	Bool bit;
+	if (stochBitsLeft == 0) {
+		/* xorshift64* */
+		stochState ^= stochState >> 12;
+		stochState ^= stochState << 25;
+		stochState ^= stochState >> 27;
+		stochBits = stochState * 2685821657736338717ULL;
+		stochBitsLeft = 64;
+	}
+	bit = (Bool)(stochBits & 1);
+	stochBits >>= 1;
+	stochBitsLeft--;
+	return bit;
+}
+
+/* neighbour of the finite x in the direction of the sign of dir */
+static __inline__
+Double nextDouble(Double x, Double dir) {
+	ULong bits;
+	if (x == 0) {
+		bits = 1;
+		x = *(Double*)&bits;
+		return dir < 0 ? -x : x;
+	}
+	bits = *(ULong*)&x;
+	if ((x > 0) == (dir > 0)) {
+		bits++;
+	} else {
+		bits--;
+	}
+	return *(Double*)&bits;
+}
+
+static __inline__
+Float nextFloat(Float x, Double dir) {
+	UInt bits;
+	if (x == 0) {
+		bits = 1;
+		x = *(Float*)&bits;
+		return dir < 0 ? -x : x;
+	}
+	bits = *(UInt*)&x;
+	if ((x > 0) == (dir > 0)) {
+		bits++;
+	} else {
+		bits--;
+	}
+	return *(Float*)&bits;
+}
+
+/* Rounds r, the double result rounded to nearest with the error err, up
+   or down at random. Float results are rounded to float first, the
+   error then includes the rounding to float. */
+static __inline__
+Double stochRound(Double r, Double err, Bool isFloat) {
+	if (!isFiniteDouble(r)) {
+		return isFloat ? (Double)(Float)r : r;
+	}
+	if (isFloat) {
+		Float f = (Float)r;
+		err += r - f;
+		if (err != 0 && isFiniteDouble(f) && stochCoin()) {
+			f = nextFloat(f, err);
+		}
+		return f;
+	}
+	if (err != 0 && stochCoin()) {
+		r = nextDouble(r, err);
+	}
+	return r;
+}
+
+static __inline__
+void stochSetDouble(Int n, Double x, Double* r) {
+	Int i;
+	for (i = 0; i < n; i++) {
+		r[i] = x;
+	}
+}
+
+static void stochAdd(Int n, Bool isFloat, const Double* a, const Double* b, Double* r) {
+	Int i;
+	for (i = 0; i < n; i++) {
+		Double s = a[i] + b[i];
+		r[i] = stochRound(s, twoSumErr(a[i], b[i], s), isFloat);
+	}
+}
+
+static void stochSub(Int n, Bool isFloat, const Double* a, const Double* b, Double* r) {
+	Int i;
+	for (i = 0; i < n; i++) {
+		Double s = a[i] - b[i];
+		r[i] = stochRound(s, twoSumErr(a[i], -b[i], s), isFloat);
+	}
+}
+
+static void stochMul(Int n, Bool isFloat, const Double* a, const Double* b, Double* r) {
+	Int i;
+	for (i = 0; i < n; i++) {
+		Double p = a[i] * b[i];
+		r[i] = stochRound(p, isFiniteDouble(p) ? twoProdErr(a[i], b[i], p) : 0, isFloat);
+	}
+}
+
+static void stochDiv(Int n, Bool isFloat, const Double* a, const Double* b, Double* r) {
+	Int i;
+	for (i = 0; i < n; i++) {
+		Double q = a[i] / b[i];
+		Double rem = divRemainder(a[i], b[i], q);
+		r[i] = stochRound(q, rem != 0 ? rem / b[i] : 0, isFloat);
+	}
+}
+
+static void stochSqrt(Int n, Bool isFloat, const Double* a, Double* r) {
+	Int i;
+	for (i = 0; i < n; i++) {
+		Double s = sqrtDouble(a[i]);
+		Double rem = sqrtRemainder(a[i], s);
+		r[i] = stochRound(s, rem != 0 ? rem / (2 * s) : 0, isFloat);
+	}
+}
+
+static __inline__
+void stochNeg(Int n, const Double* a, Double* r) {
+	Int i;
+	for (i = 0; i < n; i++) {
+		r[i] = -a[i];
+	}
+}
+
+static __inline__
+void stochAbs(Int n, const Double* a, Double* r) {
+	Int i;
+	for (i = 0; i < n; i++) {
+		r[i] = absDouble(a[i]);
+	}
+}
+
+static void stochMinMax(Int n, const Double* a, const Double* b, Bool max, Double* r) {
+	Int i;
+	for (i = 0; i < n; i++) {
+		r[i] = minMaxIsFirstDouble(a[i], b[i], max) ? a[i] : b[i];
+	}
+}
+
+static const PartsOps stochOps = {
+	stochSetDouble, stochAdd, stochSub, stochMul, stochDiv, stochSqrt, stochNeg, stochAbs, stochMinMax
+};
+
+static __inline__
+Double stochMean(Int n, const Double* a) {
+	Double sum = 0;
+	Int i;
+	for (i = 0; i < n; i++) {
+		sum += a[i];
+	}
+	return sum / n;
+}
+
+/* Relative error of the mean with a confidence of 95%, the number of
+   significant decimal digits is -log10 of it. No common digit at all
+   gives infinity. */
+static Double stochRelError(Int n, const Double* a) {
+	Double mean = stochMean(n, a);
+	Double var = 0;
+	Int i;
+
+	for (i = 0; i < n; i++) {
+		var += (a[i] - mean) * (a[i] - mean);
+	}
+	if (var == 0) {
+		return 0;
+	}
+	var /= n - 1;
+	return stochStudentT[n] * sqrtDouble(var) / (sqrtDouble(n) * absDouble(mean));
+}
+
+/*--------------------------------------------------------------------*/
+/*--- end                                                          ---*/
+/*--------------------------------------------------------------------*/
@@ -81,7 +81,9 @@ typedef
 		VG_USERREQ__RESET,
 		VG_USERREQ__INSERT_SHADOW,
 		VG_USERREQ__BEGIN,
-		VG_USERREQ__END
+		VG_USERREQ__END,
+		/* internal, used by the replacements of memcpy and memmove */
+		VG_USERREQ__COPY_MEMORY
    } Vg_FpDebugClientRequest;
 
 
@@ -181,5 +183,14 @@ typedef
     _qzz_res;                                                    \
    }))
 
+/* copies the data and the shadow values, returns 0 if it did not copy */
+#define VALGRIND_COPY_MEMORY(_qzz_dst, _qzz_src, _qzz_len)           \
+   (__extension__({unsigned long _qzz_res;                       \
+    VALGRIND_DO_CLIENT_REQUEST(_qzz_res, 0 /* default return */, \
+                            VG_USERREQ__COPY_MEMORY,       \
+                            _qzz_dst, _qzz_src, _qzz_len, 0, 0);       \
+    _qzz_res;                                                    \
+   }))
+
 #endif
 